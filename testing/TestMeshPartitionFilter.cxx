@@ -50,6 +50,10 @@
 #include "vtkXMLPPolyDataReader.h"
 #include "vtkTransform.h"
 #include "vtkGeometryFilter.h"
+#include "vtkIdList.h"
+#include "vtkPointSet.h"
+#include "vtkCommunicator.h"
+#include "vtkMultiProcessController.h"
 //
 #include <vtksys/SystemTools.hxx>
 #include <sstream>
@@ -64,6 +68,26 @@
 //
 #include "vtkMeshPartitionFilter.h"
 
+//----------------------------------------------------------------------------
+// Partition the reader output with a new filter using default options apart
+// from the partition mode, the input is not disposed
+//----------------------------------------------------------------------------
+static vtkSmartPointer<vtkMeshPartitionFilter> ReferencePartition(TestStruct &test, int partitionMode)
+{
+  vtkSmartPointer<vtkMeshPartitionFilter> reference = vtkSmartPointer<vtkMeshPartitionFilter>::New();
+  reference->SetController(test.controller);
+  reference->SetInputConnection(test.xmlreader->GetOutputPort());
+  reference->SetPartitionMode(partitionMode);
+  reference->SetBoundaryMode(test.boundaryMode);
+  vtkStreamingDemandDrivenPipeline *reference_sddp =
+    vtkStreamingDemandDrivenPipeline::SafeDownCast(reference->GetExecutive());
+  reference_sddp->UpdateInformation();
+  reference_sddp->SetUpdateExtent(0, test.myRank, test.numProcs, 0);
+  reference_sddp->Update();
+  reference->SetInputConnection(NULL);
+  return reference;
+}
+
 //----------------------------------------------------------------------------
 //----------------------------------------------------------------------------
 //----------------------------------------------------------------------------
@@ -94,7 +118,8 @@ int main (int argc, char* argv[])
   test.CreatePartitioner_Mesh();
   test.partitioner->SetInputConnection(test.xmlreader->GetOutputPort());
   test.partitioner->SetInputDisposable(1);
-  test.partitioner->SetKeepInversePointLists(1);
+  // keeping the point lists forces the two phase (points then cells) migration
+  test.partitioner->SetKeepInversePointLists(test.partitionMode==0);
   // setup ghost options
   static_cast<vtkMeshPartitionFilter *>(test.partitioner.GetPointer())
       ->SetGhostMode(test.ghostMode);
@@ -108,11 +133,38 @@ int main (int argc, char* argv[])
 
   static_cast<vtkMeshPartitionFilter *>(test.partitioner.GetPointer())
       ->SetBoundaryMode(test.boundaryMode);
+  static_cast<vtkMeshPartitionFilter *>(test.partitioner.GetPointer())
+      ->SetPartitionMode(test.partitionMode);
   static_cast<vtkMeshPartitionFilter *>(test.partitioner.GetPointer())
       ->SetKeepGhostRankArray(1);
   //
   //partition_elapsed = test.UpdatePartitioner();
 
+  //
+  // graph and hypergraph partitions should share fewer points between
+  // processes than the point partition of the same file, and refined cuts
+  // should split fewer cells than plain ones. The plain point partition is
+  // computed first for reference (the input is not disposed by this one).
+  // Likewise a migration cost aware partition should move no more bytes
+  // than the same partition mode without it.
+  //
+  bool cellPartition = (test.partitionMode==vtkMeshPartitionFilter::CellGraph ||
+                        test.partitionMode==vtkMeshPartitionFilter::CellHypergraph);
+  bool refineCuts = false;
+#if defined(VTK_RCB_PARTITION_FILTER)
+  refineCuts = test.refineCuts;
+#endif
+  vtkIdType referenceSharedPoints = -1, referenceSplitCells = -1, referenceBytesMigrated = -1;
+  if (cellPartition || refineCuts) {
+    vtkSmartPointer<vtkMeshPartitionFilter> reference = ReferencePartition(test, vtkMeshPartitionFilter::Points);
+    referenceSharedPoints = cellPartition ? reference->GetNumberOfSharedPoints() : -1;
+    referenceSplitCells   = refineCuts ? reference->GetNumberOfSplitCells() : -1;
+  }
+  if (test.migrationCost) {
+    vtkSmartPointer<vtkMeshPartitionFilter> reference = ReferencePartition(test, test.partitionMode);
+    referenceBytesMigrated = reference->GetNumberOfBytesMigrated();
+  }
+
   //--------------------------------------------------------------
   // Add process Id's
   //--------------------------------------------------------------
@@ -169,13 +221,78 @@ int main (int argc, char* argv[])
     }
   }
 
+  vtkMeshPartitionFilter *mesh = static_cast<vtkMeshPartitionFilter *>(test.partitioner.GetPointer());
+  //
+  // without ghosts every cell ends up on exactly one process, and every
+  // output cell must use points which arrived
+  //
+  vtkPointSet *partitioned = vtkPointSet::SafeDownCast(test.partitioner->GetOutputDataObject(0));
+  vtkDataSet  *original    = vtkDataSet::SafeDownCast(test.xmlreader->GetOutputDataObject(0));
+  vtkIdType cellCounts[3] = { original->GetNumberOfCells(), partitioned->GetNumberOfCells(), 0 };
+  vtkSmartPointer<vtkIdList> cellPoints = vtkSmartPointer<vtkIdList>::New();
+  for (vtkIdType cellId=0; cellId<partitioned->GetNumberOfCells(); cellId++) {
+    partitioned->GetCellPoints(cellId, cellPoints);
+    for (vtkIdType j=0; j<cellPoints->GetNumberOfIds(); j++) {
+      if (cellPoints->GetId(j)<0 || cellPoints->GetId(j)>=partitioned->GetNumberOfPoints()) {
+        cellCounts[2]++;
+        break;
+      }
+    }
+  }
+  vtkIdType globalCellCounts[3];
+  test.controller->AllReduce(cellCounts, globalCellCounts, 3, vtkCommunicator::SUM_OP);
+  if (test.myRank==0) {
+    std::cout << "Cells in : " << globalCellCounts[0] << " out : " << globalCellCounts[1]
+              << " with invalid points : " << globalCellCounts[2] << "\n";
+  }
+  ok = ok && (globalCellCounts[2]==0);
+  if (test.ghostMode==vtkMeshPartitionFilter::None) {
+    ok = ok && (globalCellCounts[0]==globalCellCounts[1]);
+  }
+  if (test.partitionMode!=vtkMeshPartitionFilter::Points && test.ghostMode==vtkMeshPartitionFilter::None) {
+    // cells are migrated whole, none may be missing a point
+    ok = ok && (mesh->GetNumberOfSplitCells()==0);
+  }
+  if (referenceSharedPoints>=0) {
+    // both counts are within the input pieces, which are the same for both
+    if (test.myRank==0) {
+      std::cout << "Shared points : " << mesh->GetNumberOfSharedPoints()
+                << " with the point partition : " << referenceSharedPoints << "\n";
+    }
+    ok = ok && (mesh->GetNumberOfSharedPoints()<=referenceSharedPoints);
+  }
+  if (referenceSplitCells>=0) {
+    if (test.myRank==0) {
+      std::cout << "Split cells : " << mesh->GetNumberOfSplitCells()
+                << " without refined cuts : " << referenceSplitCells << "\n";
+    }
+    ok = ok && (mesh->GetNumberOfSplitCells()<=referenceSplitCells);
+  }
+
+  if (referenceBytesMigrated>=0) {
+    if (test.myRank==0) {
+      std::cout << "Bytes migrated : " << mesh->GetNumberOfBytesMigrated()
+                << " without the migration cost : " << referenceBytesMigrated << "\n";
+    }
+    ok = ok && (mesh->GetNumberOfBytesMigrated()<=referenceBytesMigrated);
+  }
+
   if (ok && test.myRank==0) {
 //    DisplayParameter<vtkIdType>("Total Particles", "", &totalParticles, 1, test.myRank);
     DisplayParameter<double>("Read Time", "", &read_elapsed, 1, test.myRank);
     DisplayParameter<double>("Partition Time", "", &partition_elapsed, 1, test.myRank);
+    DisplayParameter<vtkIdType>("Shared Points", "", mesh->GetNumberOfSharedPoints(), test.myRank);
+    DisplayParameter<vtkIdType>("Split Cells", "", mesh->GetNumberOfSplitCells(), test.myRank);
+    DisplayParameter<vtkIdType>("Duplicated Points", "", mesh->GetNumberOfDuplicatedPoints(), test.myRank);
+    DisplayParameter<vtkIdType>("Ghost Cells", "", mesh->GetNumberOfGhostCells(), test.myRank);
+    DisplayParameter<vtkIdType>("Bytes Migrated", "", mesh->GetNumberOfBytesMigrated(), test.myRank);
     DisplayParameter<const char *>("====================", "", &empty, 1, test.myRank);
   }
 
+  if (!ok) {
+    retVal = 0;
+  }
+
   // manually free partitioner so Zoltan structures are freed before MPI finalize
 
   processId->SetInputConnection(NULL);
@@ -47,6 +47,8 @@
 #include "vtkOutlineSource.h"
 #include "vtkProcessIdScalars.h"
 #include "vtkTransform.h"
+#include "vtkMultiBlockDataSet.h"
+#include "vtkIntArray.h"
 //
 #include <vtksys/SystemTools.hxx>
 #include <sstream>
@@ -67,6 +69,15 @@
 //----------------------------------------------------------------------------
 #define DATA_SEND_TAG 301
 //----------------------------------------------------------------------------
+// two values derived from the coordinates, every point carries them so that
+// the receiver can check the data arrived with the right point
+//----------------------------------------------------------------------------
+static void PointPayload(const double *x, double *payload)
+{
+    payload[0] = x[0] + 2.0*x[1] + 4.0*x[2];
+    payload[1] = x[0]*x[1] - x[2];
+}
+//----------------------------------------------------------------------------
 //----------------------------------------------------------------------------
 //----------------------------------------------------------------------------
 int main (int argc, char* argv[])
@@ -96,6 +107,7 @@ int main (int argc, char* argv[])
     vtkSmartPointer<vtkIdTypeArray>   Ids = vtkSmartPointer<vtkIdTypeArray>::New();
     vtkSmartPointer<vtkIntArray>    Ranks = vtkSmartPointer<vtkIntArray>::New();
     vtkSmartPointer<vtkFloatArray> Weights = vtkSmartPointer<vtkFloatArray>::New();
+    vtkSmartPointer<vtkDoubleArray> Payload = vtkSmartPointer<vtkDoubleArray>::New();
     //
     points->SetNumberOfPoints(test.generateN);
     //
@@ -118,6 +130,23 @@ int main (int argc, char* argv[])
     Weights->SetName("Weights");
     Sprites->GetPointData()->AddArray(Weights);
     //
+    Payload->SetNumberOfComponents(2);
+    Payload->SetNumberOfTuples(test.generateN);
+    Payload->SetName("Payload");
+    Sprites->GetPointData()->AddArray(Payload);
+    //
+    // a second criterion, every fourth particle is more expensive
+    vtkSmartPointer<vtkFloatArray> Cost = vtkSmartPointer<vtkFloatArray>::New();
+    Cost->SetNumberOfTuples(test.generateN);
+    Cost->SetNumberOfComponents(1);
+    Cost->SetName("Cost");
+    for (vtkIdType Id=0; Id<test.generateN; Id++) {
+        Cost->SetValue(Id, (Id%4==0) ? 4.0f : 1.0f);
+    }
+    if (test.numWeights>1) {
+        Sprites->GetPointData()->AddArray(Cost);
+    }
+    //
     //--------------------------------------------------------------
     // Create default scalar arrays
     //--------------------------------------------------------------
@@ -132,9 +161,23 @@ int main (int argc, char* argv[])
         CubePoints(test.generateN, radius,
                 vtkFloatArray::SafeDownCast(points->GetData())->GetPointer(0), Weights->GetPointer(0));
     }
+    if (test.imbalanceThreshold>0.0) {
+        // every rank generated the same cube, move them apart (the gap is
+        // wider than the halo) and give all points the same weight so that the
+        // data is balanced and the bounds of the processes are disjoint
+        float *x = vtkFloatArray::SafeDownCast(points->GetData())->GetPointer(0);
+        for (vtkIdType Id=0; Id<test.generateN; Id++) {
+            x[3*Id] += static_cast<float>(1.5*radius*test.myRank);
+            Weights->SetValue(Id, 1.0f);
+        }
+    }
     for (vtkIdType Id=0; Id<test.generateN; Id++) {
+        double x[3], payload[2];
+        points->GetPoint(Id, x);
+        PointPayload(x, payload);
         Ids->SetTuple1(Id, Id + test.myRank*test.generateN);
         Ranks->SetTuple1(Id, test.myRank);
+        Payload->SetTuple(Id, payload);
         verts->InsertNextCell(1,&Id);
     }
     /*
@@ -152,10 +195,88 @@ int main (int argc, char* argv[])
     test.partitioner->SetInputData(Sprites);
     if (test.useWeights) {
       test.partitioner->SetPointWeightsArrayName("Weights");
+      if (test.numWeights>1) {
+        test.partitioner->AddPointWeightsArrayName("Cost");
+      }
     }
     //  test.partitioner->SetIdChannelArray("PointIds");
     static_cast<vtkParticlePartitionFilter*>(test.partitioner.GetPointer())->SetGhostHaloSize(test.ghostOverlap);
     partition_elapsed = test.UpdatePartitioner();
+    int skippedFirst = test.partitioner->GetPartitionSkipped();
+    if (test.imbalanceThreshold>0.0 && test.balancedThreshold>0.0) {
+        // rank 0 becomes a little heavier, over the balanced threshold but within
+        // the imbalance threshold, the partition is still skipped (hysteresis)
+        if (test.myRank==0) {
+            for (vtkIdType Id=0; Id<test.generateN; Id++) {
+                Weights->SetValue(Id, 1.05f);
+            }
+        }
+        Weights->Modified();
+        test.partitioner->Modified();
+        partition_elapsed += test.UpdatePartitioner();
+    }
+    int nodes = test.partitioner->GetNumberOfNodes();
+    vtkIdType offNodeHierarchical = -1, offNodeFlat = -1;
+    if (test.hierarchical) {
+        // the same points partitioned without the node level, then again with
+        // it so that the output checked below is the hierarchical one
+        offNodeHierarchical = test.partitioner->GetNumberOfObjectsMigratedOffNode();
+        test.partitioner->SetHierarchicalPartitioning(0);
+        partition_elapsed += test.UpdatePartitioner();
+        offNodeFlat = test.partitioner->GetNumberOfObjectsMigratedOffNode();
+        test.partitioner->SetHierarchicalPartitioning(1);
+        partition_elapsed += test.UpdatePartitioner();
+    }
+    bool rebalanceOk = true;
+#if defined(VTK_RCB_PARTITION_FILTER)
+    if (test.rebalance) {
+        // next time step : every rank starts from the points it owns and rank 0
+        // becomes heavier, the cuts above part 0 are out of balance but the
+        // root cut stays within the tolerance and is kept
+        vtkPolyData *previous = vtkPolyData::SafeDownCast(test.partitioner->GetOutputDataObject(0));
+        vtkFloatArray *previousWeights = vtkFloatArray::SafeDownCast(previous->GetPointData()->GetArray("Weights"));
+        vtkUnsignedCharArray *previousGhosts = vtkUnsignedCharArray::SafeDownCast(previous->GetPointData()->GetArray("vtkGhostType"));
+        vtkSmartPointer<vtkPolyData>   step        = vtkSmartPointer<vtkPolyData>::New();
+        vtkSmartPointer<vtkPoints>     stepPoints  = vtkSmartPointer<vtkPoints>::New();
+        vtkSmartPointer<vtkFloatArray> stepWeights = vtkSmartPointer<vtkFloatArray>::New();
+        vtkSmartPointer<vtkDoubleArray> stepPayload = vtkSmartPointer<vtkDoubleArray>::New();
+        vtkSmartPointer<vtkCellArray>  stepVerts   = vtkSmartPointer<vtkCellArray>::New();
+        vtkDataArray *previousPayload = previous->GetPointData()->GetArray("Payload");
+        stepWeights->SetName("Weights");
+        stepPayload->SetNumberOfComponents(2);
+        stepPayload->SetName("Payload");
+        for (vtkIdType n=0; n<previous->GetNumberOfPoints(); n++) {
+            if (previousGhosts && previousGhosts->GetValue(n)!=0) {
+                continue;
+            }
+            vtkIdType Id = stepPoints->InsertNextPoint(previous->GetPoint(n));
+            stepWeights->InsertNextValue((test.myRank==0 ? 1.15f : 1.0f)*previousWeights->GetValue(n));
+            stepPayload->InsertNextTuple(previousPayload->GetTuple(n));
+            stepVerts->InsertNextCell(1, &Id);
+        }
+        step->SetPoints(stepPoints);
+        step->SetVerts(stepVerts);
+        step->GetPointData()->AddArray(stepWeights);
+        step->GetPointData()->AddArray(stepPayload);
+        test.partitioner->SetInputData(step);
+        partition_elapsed += test.UpdatePartitioner();
+        vtkIdType migratedRebalance = test.partitioner->GetNumberOfObjectsMigrated();
+        int cutsMoved = test.partitioner->GetNumberOfCutsMoved();
+        //
+        // the same step partitioned from scratch moves the root cut too
+        //
+        test.partitioner->SetDiffusiveRebalance(0);
+        test.partitioner->Modified();
+        partition_elapsed += test.UpdatePartitioner();
+        vtkIdType migratedFull = test.partitioner->GetNumberOfObjectsMigrated();
+        rebalanceOk = (cutsMoved>0 && migratedRebalance<migratedFull);
+        if (test.myRank==0) {
+            std::cout << "Cuts moved : " << cutsMoved
+                      << " migrated by rebalance : " << migratedRebalance
+                      << " by full partition : " << migratedFull << "\n";
+        }
+    }
+#endif
 
     //--------------------------------------------------------------
     // Add process Id's
@@ -190,6 +311,27 @@ int main (int argc, char* argv[])
     vtkSmartPointer<vtkPolyData> OutputData;
     OutputData.TakeReference(vtkPolyData::SafeDownCast(sddp->GetOutputData(0)->NewInstance()));
     OutputData->ShallowCopy(sddp->GetOutputData(0));
+
+    //
+    // every local point must be in one of our pieces, one block per piece
+    //
+    bool piecesOk = true;
+    if (test.piecesPerProcess>1) {
+        vtkMultiBlockDataSet *pieces = test.partitioner->GetPiecesOutput();
+        piecesOk = pieces && static_cast<int>(pieces->GetNumberOfBlocks())==test.piecesPerProcess;
+        vtkIntArray *partIds = vtkIntArray::SafeDownCast(OutputData->GetPointData()->GetArray("vtkPartitionId"));
+        vtkUnsignedCharArray *ghosts = vtkUnsignedCharArray::SafeDownCast(OutputData->GetPointData()->GetArray("vtkGhostType"));
+        piecesOk = piecesOk && partIds && ghosts;
+        for (vtkIdType n=0; piecesOk && n<OutputData->GetNumberOfPoints(); ++n) {
+            int piece = partIds->GetValue(n);
+            if (ghosts->GetValue(n)==0 && test.partitioner->GetProcessOfPiece(piece)!=test.myRank) {
+                piecesOk = false;
+            }
+        }
+        if (!piecesOk) {
+            std::cout << "Rank " << test.myRank << " pieces output incorrect\n";
+        }
+    }
     if (test.myRank>0) {
         test.controller->Send(OutputData, 0, DATA_SEND_TAG);
     }
@@ -200,6 +342,7 @@ int main (int argc, char* argv[])
         //
         std::vector<int> pointsCounts(test.numProcs, 0);
         std::vector<double> weightCounts(test.numProcs, 0);
+        vtkIdType ghostCount = 0, payloadErrors = 0;
         //
         for (int i=0; i<test.numProcs; i++) {
             vtkSmartPointer<vtkPolyData> pd;
@@ -215,15 +358,29 @@ int main (int argc, char* argv[])
             //        pd->PrintSelf(std::cout, vtkIndent(0));
             vtkFloatArray *weights = vtkFloatArray::SafeDownCast(pd->GetPointData()->GetArray("Weights"));
             vtkUnsignedCharArray *ghosts = vtkUnsignedCharArray::SafeDownCast(pd->GetPointData()->GetArray("vtkGhostType"));
+            vtkDataArray *payloads = pd->GetPointData()->GetArray("Payload");
 
             for (int n = 0; n < weights->GetNumberOfTuples(); ++n)
             {
+                // every point, ghost or not, must carry the payload of its coordinates
+                double x[3], payload[2];
+                pd->GetPoint(n, x);
+                PointPayload(x, payload);
+                for (int c=0; c<2; c++) {
+                    if (!payloads || fabs(payloads->GetComponent(n, c)-payload[c])>1E-9*(1.0+fabs(payload[c]))) {
+                        payloadErrors++;
+                        break;
+                    }
+                }
                 // ghost cells are trnasferred in and are were not used for the weighting
                 int ghost = ghosts->GetValue(n);
                 if (ghost==0) {
                     weightCounts[i] += weights->GetValue(n);
                     pointsCounts[i] ++;
                 }
+                else {
+                    ghostCount++;
+                }
             }
         }
         for (int i=0; i<test.numProcs; i++){
@@ -235,20 +392,98 @@ int main (int argc, char* argv[])
         double sq_sum = std::inner_product(weightCounts.begin(), weightCounts.end(), weightCounts.begin(), 0.0);
         double stdev = std::sqrt(sq_sum / weightCounts.size() - mean * mean);
         std::cout << "standard deviation : " << stdev << ")\n";
-#ifdef VTK_ZOLTAN1_PARTITION_FILTER
+        std::cout << "Nodes : " << test.partitioner->GetNumberOfNodes()
+                  << " objects migrated off node : " << test.partitioner->GetNumberOfObjectsMigratedOffNode() << "\n";
+        for (int c=0; c<test.partitioner->GetNumberOfWeightCriteria(); c++) {
+            std::cout << "Criterion " << c << " imbalance : " << test.partitioner->GetCriterionImbalance(c) << "\n";
+        }
+#if defined(VTK_ZOLTAN1_PARTITION_FILTER) || defined(VTK_ZOLTAN2_PARTITION_FILTER)
+        if (test.numWeights>1) {
+            // criteria are balanced together, none should be badly out
+            ok = true;
+            for (int c=0; c<test.partitioner->GetNumberOfWeightCriteria(); c++) {
+                ok = ok && (test.partitioner->GetCriterionImbalance(c)<1.5);
+            }
+        }
+        else
+#endif
+#if defined(VTK_SFC_PARTITION_FILTER)
+        // splitters are refined to within 1% of the mean weight by default
+        ok = (stdev<0.01*mean);
+#elif defined(VTK_RCB_PARTITION_FILTER)
+        // cuts are placed on histogram bin edges, not exactly at the median
+        ok = (stdev<0.05*mean);
+#elif defined(VTK_ZOLTAN1_PARTITION_FILTER)
         ok = (stdev<0.7);
 #else
-        ok = (stdev<0.2);
+        if (test.partitioner->GetPartitionBackend()==vtkZoltanV2PartitionFilter::Zoltan1) {
+          ok = (stdev<0.7);
+        }
+        else {
+          ok = (stdev<0.2);
+        }
 #endif
+        if (test.partitioner->GetNumberOfSamplePoints()>0) {
+            // the cuts balance the sample, all points are only balanced statistically
+            std::cout << "Sample points : " << test.partitioner->GetNumberOfSamplePoints()
+                      << " sample imbalance : " << test.partitioner->GetSampleImbalance() << "\n";
+            ok = (stdev<0.2*mean);
+        }
+        if (test.imbalanceThreshold>0.0) {
+            // every rank holds its own balanced block, nothing is moved and the
+            // halos, built from the disjoint process bounds, hold no point
+            std::cout << "Partition skipped : " << skippedFirst << " " << test.partitioner->GetPartitionSkipped()
+                      << " migrated : " << test.partitioner->GetNumberOfObjectsMigrated()
+                      << " ghosts : " << ghostCount << "\n";
+            ok = skippedFirst && test.partitioner->GetPartitionSkipped() &&
+                 test.partitioner->GetNumberOfObjectsMigrated()==0 && ghostCount==0;
+            if (test.balancedThreshold>0.0) {
+                // the last execution is balanced to within the upper threshold only
+                ok = ok && test.partitioner->GetCriterionImbalance(0)>test.balancedThreshold;
+            }
+        }
+        if (test.excludeRank0) {
+            // rank 0 has capacity 0, the other ranks share all the weight
+            std::cout << "Rank 0 target fraction : " << test.partitioner->GetProcessTargetFraction(0) << "\n";
+            ok = (pointsCounts[0]==0 && test.partitioner->GetCriterionImbalance(0)<1.5);
+        }
+        if (payloadErrors>0) {
+            // a wrong offset in the migration mixes the data of different points
+            std::cout << "Points with a wrong payload : " << payloadErrors << "\n";
+            ok = false;
+        }
+        if (test.sparseMigration && test.transport>0) {
+            // the payload above was received with point to point messages
+            std::cout << "Point to point migration : " << test.partitioner->GetSparseMigrationUsed() << "\n";
+            ok = ok && test.partitioner->GetSparseMigrationUsed();
+        }
+        if (test.maxMigrationBuffer>0 && test.transport>0) {
+            // the points were sent in several rounds within the buffer limit
+            std::cout << "Peak migration buffer : " << test.partitioner->GetPeakMigrationBufferBytes()
+                      << " in rounds : " << test.partitioner->GetNumberOfMigrationRounds() << "\n";
+            ok = ok && test.partitioner->GetPeakMigrationBufferBytes()<=test.maxMigrationBuffer;
+            ok = ok && test.partitioner->GetNumberOfMigrationRounds()>1;
+        }
+        if (test.rebalance) {
+            // only the points near the moved cuts changed process
+            ok = ok && rebalanceOk;
+        }
+        if (test.hierarchical) {
+            // the node level ran and kept at least as much of the migration on the nodes
+            std::cout << "Objects migrated off node : " << offNodeHierarchical
+                      << " without the node level : " << offNodeFlat << "\n";
+            ok = ok && nodes>1 && nodes<test.numProcs && offNodeHierarchical<=offNodeFlat;
+        }
     }
 
     if (ok && test.myRank==0) {
         DisplayParameter<vtkIdType>("Total Particles", "", &totalParticles, 1, test.myRank);
         DisplayParameter<double>("Read Time", "", &read_elapsed, 1, test.myRank);
         DisplayParameter<double>("Partition Time", "", &partition_elapsed, 1, test.myRank);
+        DisplayParameter<vtkIdType>("Peak Migration Buffer", "", test.partitioner->GetPeakMigrationBufferBytes(), test.myRank);
         DisplayParameter<const char *>("====================", "", &empty, 1, test.myRank);
     }
-    retVal = (ok==true);
+    retVal = (ok==true && piecesOk);
 
     test.controller->Finalize();
 
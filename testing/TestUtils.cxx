@@ -189,6 +189,21 @@ int initTest(int argc, char* argv[], TestStruct &test)
   test.generateN = GetParameter<vtkIdType>("-generateParticles", "Generated Particles", argc, argv, 0, test.myRank, unused);
   test.particleGenerator = GetParameter<int>("-particleGenerator", "Generator for particles (sphere=0, cube=1)", argc, argv, 0, test.myRank, unused);
   test.useWeights = GetParameter<bool>("-useWeights", "Enable weights in partitioning", argc, argv, 0, test.myRank, unused);
+  test.numWeights = GetParameter<int>("-numWeights", "Number of weight criteria", argc, argv, 1, test.myRank, unused);
+  test.hierarchical = GetParameter<bool>("-hierarchical", "Partition nodes then ranks", argc, argv, 0, test.myRank, unused);
+  test.virtualRanksPerNode = GetParameter<int>("-virtualRanksPerNode", "Ranks per emulated node", argc, argv, 0, test.myRank, unused);
+  test.piecesPerProcess = GetParameter<int>("-piecesPerProcess", "Pieces per process", argc, argv, 1, test.myRank, unused);
+  test.sampleFraction = GetParameter<double>("-sampleFraction", "Fraction of points used for the cuts", argc, argv, 0.0, test.myRank, unused);
+  test.backend = GetParameter<int>("-backend", "Zoltan2 build backend (default=0, zoltan=1, zoltan2=2)", argc, argv, 0, test.myRank, unused);
+  test.excludeRank0 = GetParameter<bool>("-excludeRank0", "Give rank 0 no data (capacity 0)", argc, argv, 0, test.myRank, unused);
+  test.migrationCost = GetParameter<bool>("-migrationCost", "Migration cost aware repartitioning", argc, argv, 0, test.myRank, unused);
+  test.rebalance = GetParameter<bool>("-rebalance", "Drift the weights and rebalance the previous cuts", argc, argv, 0, test.myRank, unused);
+  test.imbalanceThreshold = GetParameter<double>("-imbalanceThreshold", "Skip the partition below this imbalance", argc, argv, 0.0, test.myRank, unused);
+  test.balancedThreshold = GetParameter<double>("-balancedThreshold", "Resume skipping below this imbalance", argc, argv, 0.0, test.myRank, unused);
+  test.refineCuts = GetParameter<bool>("-refineCuts", "Move the cuts to sparse positions", argc, argv, 0, test.myRank, unused);
+  test.transport = GetParameter<int>("-transport", "Point migration transport", argc, argv, 0, test.myRank, unused);
+  test.maxMigrationBuffer = GetParameter<vtkIdType>("-maxMigrationBuffer", "Migration buffer limit in bytes", argc, argv, 0, test.myRank, unused);
+  test.sparseMigration = GetParameter<bool>("-sparseMigration", "Always migrate with point to point messages", argc, argv, 0, test.myRank, unused);
 
   //
   // File load / H5Part info
@@ -215,6 +230,7 @@ int initTest(int argc, char* argv[], TestStruct &test)
   // Boundary
   //
   test.boundaryMode = GetParameter<int>("-boundaryMode", "Boundary {f=0,m=1,a=2}", argc, argv, 0, test.myRank, unused);
+  test.partitionMode = GetParameter<int>("-partitionMode", "Partition {points=0,graph=1,hypergraph=2,centroid=3}", argc, argv, 0, test.myRank, unused);
 
   //
   // SPH kernel or neighbour info
@@ -347,12 +363,42 @@ void TestStruct::DeleteXMLReader()
   this->xmlreader = NULL;
 }
 
+//----------------------------------------------------------------------------
+void TestStruct::ConfigurePartitioner()
+{
+  this->partitioner->SetController(this->controller);
+  this->partitioner->SetHierarchicalPartitioning(this->hierarchical);
+  this->partitioner->SetVirtualRanksPerNode(this->virtualRanksPerNode);
+  this->partitioner->SetPiecesPerProcess(this->piecesPerProcess);
+  this->partitioner->SetSampleFraction(this->sampleFraction);
+  this->partitioner->SetMigrationCostAware(this->migrationCost);
+  this->partitioner->SetImbalanceThreshold(this->imbalanceThreshold);
+  this->partitioner->SetBalancedThreshold(this->balancedThreshold);
+  this->partitioner->SetMigrationTransport(this->transport);
+  this->partitioner->SetMaxMigrationBufferBytes(this->maxMigrationBuffer);
+  if (this->sparseMigration) {
+    this->partitioner->SetSparseMigrationFraction(1.0);
+  }
+  if (this->excludeRank0) {
+    this->partitioner->AddProcessCapacity(0.0);
+  }
+#if defined(VTK_ZOLTAN2_PARTITION_FILTER)
+  if (this->backend>0) {
+    this->partitioner->SetPartitionBackend(this->backend);
+  }
+#endif
+#if defined(VTK_RCB_PARTITION_FILTER)
+  this->partitioner->SetDiffusiveRebalance(this->rebalance);
+  this->partitioner->SetRefineCuts(this->refineCuts);
+#endif
+}
+
 //----------------------------------------------------------------------------
 void TestStruct::CreatePartitioner_Particles()
 {
   testDebugMacro( "Creating Partitioner " << this->myRank << " of " << this->numProcs );
   this->partitioner = vtkSmartPointer<vtkParticlePartitionFilter>::New();
-  this->partitioner->SetController(this->controller);
+  this->ConfigurePartitioner();
 }
 
 //----------------------------------------------------------------------------
@@ -360,7 +406,7 @@ void TestStruct::CreatePartitioner_Mesh()
 {
   testDebugMacro( "Creating Partitioner " << this->myRank << " of " << this->numProcs );
   this->partitioner = vtkSmartPointer<vtkMeshPartitionFilter>::New();
-  this->partitioner->SetController(this->controller);
+  this->ConfigurePartitioner();
 }
 
 //----------------------------------------------------------------------------
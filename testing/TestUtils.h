@@ -89,6 +89,21 @@ class TestStruct {
   vtkIdType   generateN;
   int         particleGenerator;
   bool        useWeights;
+  int         numWeights;
+  bool        hierarchical;
+  int         virtualRanksPerNode;
+  int         piecesPerProcess;
+  double      sampleFraction;
+  int         backend;
+  bool        excludeRank0;
+  bool        migrationCost;
+  bool        rebalance;
+  double      imbalanceThreshold;
+  double      balancedThreshold;
+  bool        refineCuts;
+  int         transport;
+  vtkIdType   maxMigrationBuffer;
+  bool        sparseMigration;
 
   //
   // H5Part Reader 
@@ -110,6 +125,7 @@ class TestStruct {
   double      ghostOverlap;
   int         ghostLevels;
   int         boundaryMode;
+  int         partitionMode;
   int         maxN;
   std::string massScalars;
   std::string densityScalars;
@@ -135,6 +151,7 @@ class TestStruct {
   void    CreateXMLPUnstructuredGridReader();
   void    CreateXMLReader();
   void    DeleteXMLReader();
+  void    ConfigurePartitioner(); // settings shared by all the partitioners
   void    CreatePartitioner_Particles();
   void    CreatePartitioner_Mesh();
   double  UpdatePartitioner();
@@ -18,6 +18,7 @@
 #include "vtkStreamingDemandDrivenPipeline.h"
 #include "vtkPolyData.h"
 #include "vtkUnstructuredGrid.h"
+#include "vtkMultiBlockDataSet.h"
 #include "vtkDataSetAttributes.h"
 #include "vtkPointData.h"
 #include "vtkCellData.h"
@@ -34,6 +35,8 @@
 #include "vtkPointLocator.h"
 #include "vtkPKdTree.h"
 #include "vtkCellTreeLocator.h"
+#include "vtkMultiProcessController.h"
+#include "vtkCommunicator.h"
 //
 // For PARAVIEW_USE_MPI
 #include "vtkPVConfig.h"
@@ -54,6 +57,7 @@
 #include <float.h>
 #include <numeric>
 #include <algorithm>
+#include <tuple>
 
 //----------------------------------------------------------------------------
 #if defined ZOLTAN_DEBUG_OUTPUT && !defined VTK_WRAPPING_CXX
@@ -433,6 +437,281 @@ void vtkMeshPartitionFilter::zoltan_unpack_obj_function_cell(void *data, int num
   return;
 }
 //----------------------------------------------------------------------------
+// Zoltan callback which returns number of cells participating in the partition
+//----------------------------------------------------------------------------
+int vtkMeshPartitionFilter::get_number_of_objects_cells(void *data, int *ierr)
+{
+  vtkMeshPartitionFilter *self = static_cast<vtkMeshPartitionFilter*>(data);
+  int res = self->ZoltanCallbackData.Input->GetNumberOfCells();
+  *ierr = (res < 0) ? ZOLTAN_FATAL : ZOLTAN_OK;
+  return res;
+}
+//----------------------------------------------------------------------------
+// Zoltan callback which returns the migration size in bytes of each cell
+//----------------------------------------------------------------------------
+void vtkMeshPartitionFilter::get_object_sizes_cells(void *data, int num_gid_entries,
+  int num_lid_entries, int num_ids, ZOLTAN_ID_PTR global_ids, ZOLTAN_ID_PTR local_ids,
+  int *sizes, int *ierr)
+{
+  vtkMeshPartitionFilter *self = static_cast<vtkMeshPartitionFilter*>(data);
+  vtkIdType offset = self->ZoltanCallbackData.ProcessOffsetsCellId[self->ZoltanCallbackData.ProcessRank];
+  for (int i=0; i<num_ids; ++i) {
+    sizes[i] = self->CellBytes[global_ids[i] - offset];
+  }
+  *ierr = ZOLTAN_OK;
+}
+//----------------------------------------------------------------------------
+// Zoltan callback which fills the Ids for each cell in the partition
+//----------------------------------------------------------------------------
+void vtkMeshPartitionFilter::get_object_list_cells(void *data, int sizeGID, int sizeLID,
+  ZOLTAN_ID_PTR globalID, ZOLTAN_ID_PTR localID, int wgt_dim, float *obj_wgts, int *ierr)
+{
+  vtkMeshPartitionFilter *self = static_cast<vtkMeshPartitionFilter*>(data);
+  CallbackData *callbackdata = &self->ZoltanCallbackData;
+  *ierr = ZOLTAN_OK;
+  vtkIdType N = callbackdata->Input->GetNumberOfCells();
+  for (vtkIdType i=0; i<N; ++i) {
+    globalID[i] = i + callbackdata->ProcessOffsetsCellId[callbackdata->ProcessRank];
+  }
+}
+//----------------------------------------------------------------------------
+// Zoltan callback : number of neighbours of each cell in the dual graph
+//----------------------------------------------------------------------------
+void vtkMeshPartitionFilter::get_num_edges_list_cells(void *data, int sizeGID, int sizeLID, int num_obj,
+  ZOLTAN_ID_PTR globalID, ZOLTAN_ID_PTR localID, int *numEdges, int *ierr)
+{
+  vtkMeshPartitionFilter *self = static_cast<vtkMeshPartitionFilter*>(data);
+  vtkIdType offset = self->ZoltanCallbackData.ProcessOffsetsCellId[self->ZoltanCallbackData.ProcessRank];
+  for (int i=0; i<num_obj; ++i) {
+    vtkIdType LID = globalID[i] - offset;
+    numEdges[i] = static_cast<int>(self->CellGraphOffsets[LID+1] - self->CellGraphOffsets[LID]);
+  }
+  *ierr = ZOLTAN_OK;
+}
+//----------------------------------------------------------------------------
+// Zoltan callback : neighbours of each cell in the dual graph, the graph only
+// connects cells of this process (shared points are not known across processes)
+//----------------------------------------------------------------------------
+void vtkMeshPartitionFilter::get_edge_list_cells(void *data, int sizeGID, int sizeLID, int num_obj,
+  ZOLTAN_ID_PTR globalID, ZOLTAN_ID_PTR localID, int *num_edges,
+  ZOLTAN_ID_PTR nborGID, int *nborProc, int wgt_dim, float *ewgts, int *ierr)
+{
+  vtkMeshPartitionFilter *self = static_cast<vtkMeshPartitionFilter*>(data);
+  vtkIdType offset = self->ZoltanCallbackData.ProcessOffsetsCellId[self->ZoltanCallbackData.ProcessRank];
+  vtkIdType e = 0;
+  for (int i=0; i<num_obj; ++i) {
+    vtkIdType LID = globalID[i] - offset;
+    for (vtkIdType k=self->CellGraphOffsets[LID]; k<self->CellGraphOffsets[LID+1]; ++k, ++e) {
+      nborGID[e]  = self->CellGraphAdjacency[k] + offset;
+      nborProc[e] = self->ZoltanCallbackData.ProcessRank;
+      if (wgt_dim) {
+        ewgts[e] = self->CellGraphWeights[k];
+      }
+    }
+  }
+  *ierr = ZOLTAN_OK;
+}
+//----------------------------------------------------------------------------
+// Zoltan callback : size of the hypergraph, one hyperedge for each point
+// used by more than one cell, the pins are the cells using the point
+//----------------------------------------------------------------------------
+void vtkMeshPartitionFilter::get_hypergraph_size_cells(void *data, int *num_lists, int *num_pins,
+  int *format, int *ierr)
+{
+  vtkMeshPartitionFilter *self = static_cast<vtkMeshPartitionFilter*>(data);
+  vtkIdType numPts = static_cast<vtkIdType>(self->PointCellOffsets.size()) - 1;
+  *num_lists = 0;
+  *num_pins  = 0;
+  for (vtkIdType i=0; i<numPts; ++i) {
+    vtkIdType n = self->PointCellOffsets[i+1] - self->PointCellOffsets[i];
+    if (n>1) {
+      (*num_lists)++;
+      (*num_pins) += static_cast<int>(n);
+    }
+  }
+  *format = ZOLTAN_COMPRESSED_EDGE;
+  *ierr   = ZOLTAN_OK;
+}
+//----------------------------------------------------------------------------
+// Zoltan callback : hyperedges (point GIDs) and their pins (cell GIDs)
+//----------------------------------------------------------------------------
+void vtkMeshPartitionFilter::get_hypergraph_cells(void *data, int sizeGID, int num_edges, int num_pins,
+  int format, ZOLTAN_ID_PTR edgeGID, int *vtxPtr, ZOLTAN_ID_PTR vtxGID, int *ierr)
+{
+  vtkMeshPartitionFilter *self = static_cast<vtkMeshPartitionFilter*>(data);
+  CallbackData *callbackdata = &self->ZoltanCallbackData;
+  vtkIdType pointOffset = callbackdata->ProcessOffsetsPointId[callbackdata->ProcessRank];
+  vtkIdType cellOffset  = callbackdata->ProcessOffsetsCellId[callbackdata->ProcessRank];
+  vtkIdType numPts = static_cast<vtkIdType>(self->PointCellOffsets.size()) - 1;
+  int e = 0, pin = 0;
+  for (vtkIdType i=0; i<numPts && e<num_edges; ++i) {
+    if (self->PointCellOffsets[i+1] - self->PointCellOffsets[i] < 2) {
+      continue;
+    }
+    edgeGID[e] = i + pointOffset;
+    vtxPtr[e]  = pin;
+    for (vtkIdType k=self->PointCellOffsets[i]; k<self->PointCellOffsets[i+1]; ++k) {
+      vtxGID[pin++] = self->PointCellIds[k] + cellOffset;
+    }
+    e++;
+  }
+  *ierr = (e==num_edges && pin==num_pins) ? ZOLTAN_OK : ZOLTAN_FATAL;
+}
+//----------------------------------------------------------------------------
+// Zoltan callback : the coordinates of each cell object are the cell centroid
+//----------------------------------------------------------------------------
+template<typename T>
+void vtkMeshPartitionFilter::get_geometry_list_cells(void *data, int sizeGID, int sizeLID, int num_obj,
+  ZOLTAN_ID_PTR globalID, ZOLTAN_ID_PTR localID, int num_dim, double *geom_vec, int *ierr)
+{
+  vtkMeshPartitionFilter *self = static_cast<vtkMeshPartitionFilter*>(data);
+  CallbackData *callbackdata = &self->ZoltanCallbackData;
+  vtkIdType offset = callbackdata->ProcessOffsetsCellId[callbackdata->ProcessRank];
+  vtkPolyData         *pdata = vtkPolyData::SafeDownCast(callbackdata->Input);
+  vtkUnstructuredGrid *udata = vtkUnstructuredGrid::SafeDownCast(callbackdata->Input);
+  vtkIdType npts, *pts;
+  T centroid[3];
+  for (int i=0; i<num_obj; ++i) {
+    vtkIdType LID = globalID[i] - offset;
+    if (pdata) { pdata->GetCellPoints(LID, npts, pts); }
+    else { udata->GetCellPoints(LID, npts, pts); }
+    self->FindCentroid<T>(npts, pts, callbackdata, centroid);
+    geom_vec[3*i]   = centroid[0];
+    geom_vec[3*i+1] = centroid[1];
+    geom_vec[3*i+2] = centroid[2];
+  }
+  *ierr = ZOLTAN_OK;
+}
+//----------------------------------------------------------------------------
+// Zoltan callback : size of one cell, its data, and the points it carries
+//----------------------------------------------------------------------------
+template <typename T>
+int vtkMeshPartitionFilter::zoltan_obj_size_function_cell_points(void *data, int num_gid_entries, int num_lid_entries,
+  ZOLTAN_ID_PTR global_id, ZOLTAN_ID_PTR local_id, int *ierr)
+{
+  INC_SIZE_COUNT
+  CallbackData *callbackdata = static_cast<CallbackData*>(data);
+  vtkMeshPartitionFilter *self = static_cast<vtkMeshPartitionFilter*>(callbackdata->self);
+  vtkIdType LID = *global_id - callbackdata->ProcessOffsetsCellId[callbackdata->ProcessRank];
+  vtkIdType first = self->CellPointOffsets[LID];
+  vtkIdType npts  = self->CellPointOffsets[LID+1] - first;
+  vtkIdType carried = std::count(self->CarryPoint.begin()+first, self->CarryPoint.begin()+first+npts, 1);
+  *ierr = ZOLTAN_OK;
+  // cell data + {npts, ctype, carried} + point Ids + {Id, xyz, point data} for each carried point
+  return static_cast<int>(callbackdata->TotalSizePerId + (3+npts)*sizeof(vtkIdType)
+    + carried*(sizeof(vtkIdType) + 3*sizeof(T) + self->PointTotalSizePerId));
+}
+//----------------------------------------------------------------------------
+// Zoltan callback : pack one cell, its data, and the points it carries
+//----------------------------------------------------------------------------
+template <typename T>
+void vtkMeshPartitionFilter::zoltan_pack_obj_function_cell_points(void *data, int num_gid_entries, int num_lid_entries,
+  ZOLTAN_ID_PTR global_id, ZOLTAN_ID_PTR local_id, int dest, int size, char *buf, int *ierr)
+{
+  INC_PACK_COUNT
+  CallbackData *callbackdata = static_cast<CallbackData*>(data);
+  vtkMeshPartitionFilter *self = static_cast<vtkMeshPartitionFilter*>(callbackdata->self);
+  vtkIdType LID = *global_id - callbackdata->ProcessOffsetsCellId[callbackdata->ProcessRank];
+  vtkIdType pointOffset = callbackdata->ProcessOffsetsPointId[callbackdata->ProcessRank];
+  //
+  for (int i=0; i<callbackdata->NumberOfFields; i++) {
+    int asize = callbackdata->MemoryPerTuple[i];
+    char *dataptr = (char*)(callbackdata->InputArrayPointers[i]) + asize*LID;
+    memcpy(buf, dataptr, asize);
+    buf += asize;
+  }
+  //
+  vtkIdType npts, *pts, header[3];
+  vtkPolyData         *pdata = vtkPolyData::SafeDownCast(callbackdata->Input);
+  vtkUnstructuredGrid *udata = vtkUnstructuredGrid::SafeDownCast(callbackdata->Input);
+  if (pdata) {
+    header[1] = pdata->GetCellType(LID);
+    pdata->GetCellPoints(LID, npts, pts);
+  }
+  else {
+    header[1] = udata->GetCellType(LID);
+    udata->GetCellPoints(LID, npts, pts);
+  }
+  const unsigned char *carry = &self->CarryPoint[self->CellPointOffsets[LID]];
+  header[0] = npts;
+  header[2] = std::count(carry, carry+npts, 1);
+  memcpy(buf, header, sizeof(vtkIdType)*3);
+  buf += sizeof(vtkIdType)*3;
+  // point Ids are sent as global Ids
+  for (int i=0; i<npts; i++) {
+    vtkIdType GID = pts[i] + pointOffset;
+    memcpy(buf, &GID, sizeof(vtkIdType));
+    buf += sizeof(vtkIdType);
+  }
+  // followed by the points the destination does not have yet
+  for (int i=0; i<npts; i++) {
+    if (!carry[i]) {
+      continue;
+    }
+    vtkIdType GID = pts[i] + pointOffset;
+    memcpy(buf, &GID, sizeof(vtkIdType));
+    buf += sizeof(vtkIdType);
+    memcpy(buf, &((T*)(callbackdata->InputPointsData))[pts[i]*3], sizeof(T)*3);
+    buf += sizeof(T)*3;
+    for (size_t f=0; f<self->PointMemoryPerTuple.size(); f++) {
+      int asize = self->PointMemoryPerTuple[f];
+      memcpy(buf, (char*)(self->PointInputArrayPointers[f]) + asize*pts[i], asize);
+      buf += asize;
+    }
+  }
+  *ierr = ZOLTAN_OK;
+}
+//----------------------------------------------------------------------------
+// Zoltan callback : unpack one cell, its data, and the points it carries.
+// The cell may use points carried by a cell which has not arrived yet, so
+// the connectivity is kept in PendingCells until the migration is complete
+//----------------------------------------------------------------------------
+template <typename T>
+void vtkMeshPartitionFilter::zoltan_unpack_obj_function_cell_points(void *data, int num_gid_entries,
+  ZOLTAN_ID_PTR global_id, int size, char *buf, int *ierr)
+{
+  INC_UNPACK_COUNT
+  CallbackData *callbackdata = static_cast<CallbackData*>(data);
+  vtkMeshPartitionFilter *self = static_cast<vtkMeshPartitionFilter*>(callbackdata->self);
+  //
+  for (int i=0; i<callbackdata->NumberOfFields; i++) {
+    int asize = callbackdata->MemoryPerTuple[i];
+    char *dataptr = (char*)(callbackdata->OutputArrayPointers[i]) + asize*(callbackdata->OutCellCount);
+    memcpy(dataptr, buf, asize);
+    buf += asize;
+  }
+  //
+  vtkIdType header[3], GID;
+  memcpy(header, buf, sizeof(vtkIdType)*3);
+  buf += sizeof(vtkIdType)*3;
+  self->PendingCells.push_back(header[0]);
+  self->PendingCells.push_back(header[1]);
+  for (vtkIdType i=0; i<header[0]; i++) {
+    memcpy(&GID, buf, sizeof(vtkIdType));
+    buf += sizeof(vtkIdType);
+    self->PendingCells.push_back(GID);
+  }
+  //
+  for (vtkIdType i=0; i<header[2]; i++) {
+    memcpy(&GID, buf, sizeof(vtkIdType));
+    buf += sizeof(vtkIdType);
+    memcpy(&((T*)(callbackdata->OutputPointsData))[callbackdata->OutPointCount*3], buf, sizeof(T)*3);
+    buf += sizeof(T)*3;
+    for (size_t f=0; f<self->PointMemoryPerTuple.size(); f++) {
+      int asize = self->PointMemoryPerTuple[f];
+      memcpy((char*)(self->PointOutputArrayPointers[f]) + asize*callbackdata->OutPointCount, buf, asize);
+      buf += asize;
+    }
+    self->ReceivedPointIds[GID] = callbackdata->OutPointCount;
+    callbackdata->OutPointCount++;
+  }
+  if (callbackdata->OutputUnstructuredCellTypes) {
+    callbackdata->OutputUnstructuredCellTypes[callbackdata->OutCellCount] = static_cast<int>(header[1]);
+  }
+  callbackdata->OutCellCount++;
+  *ierr = ZOLTAN_OK;
+}
+//----------------------------------------------------------------------------
 // vtkMeshPartitionFilter :: implementation
 //----------------------------------------------------------------------------
 vtkMeshPartitionFilter::vtkMeshPartitionFilter()
@@ -444,15 +723,18 @@ vtkMeshPartitionFilter::vtkMeshPartitionFilter()
   this->ghost_cell_flags    = NULL;
   this->ghost_cell_out_rank = NULL;
   this->KeepGhostRankArray  = 0;
+  this->PartitionMode       = vtkMeshPartitionFilter::Points;
+  this->NumberOfSharedPoints     = 0;
+  this->NumberOfSplitCells       = 0;
+  this->NumberOfDuplicatedPoints = 0;
+  this->NumberOfGhostCells       = 0;
+  this->DroppedCells             = 0;
+  this->PointTotalSizePerId      = 0;
   //this->DebugOn();
 }
 //----------------------------------------------------------------------------
 vtkMeshPartitionFilter::~vtkMeshPartitionFilter()
 {
-  if (this->ZoltanData) {
-    Zoltan_Destroy(&this->ZoltanData);
-    this->ZoltanData = NULL;
-  }
   // free up SmartPointers
   this->ghost_cell_rank     = NULL;
   this->ghost_cell_flags    = NULL;
@@ -472,11 +754,14 @@ int vtkMeshPartitionFilter::RequestData(vtkInformation* info,
   // Calculate even distribution of points across processes
   // This step only performs the load balance analysis,
   // no actual sending of data takes place yet.
+  // (when PartitionMode is not Points, the cells are partitioned here too)
   //
+  this->CellDestinations.clear();
   this->PartitionPoints(info, inputVector, outputVector);
 
   if (this->UpdateNumPieces==1) {
     // input has been copied to output during PartitionPoints
+    this->ExtractPieces(vtkPointSet::GetData(outputVector, 0), vtkMultiBlockDataSet::GetData(outputVector, 1));
     return 1;
   }
 
@@ -523,96 +808,394 @@ int vtkMeshPartitionFilter::RequestData(vtkInformation* info,
   }
 
   //
-  // based on the point partition, decide which cells need to be sent away
-  // sending some cells may imply sending a few extra points too
+  // when the cells have been partitioned and no ghost cells or point lists
+  // are needed afterwards, cells are sent once carrying the points they use
   //
-  PartitionInfo cell_partitioninfo;
-
-  vtkDebugMacro("Calling BuildCellToProcessList");
-  if (this->ZoltanCallbackData.PointType==VTK_FLOAT) {
-    this->BuildCellToProcessList<float>(
-      this->ZoltanCallbackData.Input,
-      cell_partitioninfo,       // lists of which cells to send to which process
-      this->MigrateLists.known, // list of which points to send to which process
-      this->LoadBalanceData     // the partition information generated during PartitionPoints
-    );
-  }
-  else if (this->ZoltanCallbackData.PointType==VTK_DOUBLE) {
-    this->BuildCellToProcessList<double>(
-      this->ZoltanCallbackData.Input,
-      cell_partitioninfo,       // lists of which cells to send to which process
-      this->MigrateLists.known, // list of which points to send to which process
-      this->LoadBalanceData     // the partition information generated during PartitionPoints
-    );
+  bool singlePhase = !this->CellDestinations.empty() &&
+    this->GhostMode==vtkMeshPartitionFilter::None && !this->KeepInversePointLists;
+  if (singlePhase) {
+    vtkDebugMacro("Single phase cell migration");
+    if (this->ZoltanCallbackData.PointType==VTK_FLOAT) {
+      this->MigrateCellsSinglePhase<float>();
+    }
+    else if (this->ZoltanCallbackData.PointType==VTK_DOUBLE) {
+      this->MigrateCellsSinglePhase<double>();
+    }
   }
+  else {
+    //
+    // based on the point partition, decide which cells need to be sent away
+    // sending some cells may imply sending a few extra points too
+    //
+    PartitionInfo cell_partitioninfo;
+
+    vtkDebugMacro("Calling BuildCellToProcessList");
+    if (this->ZoltanCallbackData.PointType==VTK_FLOAT) {
+      this->BuildCellToProcessList<float>(
+        this->ZoltanCallbackData.Input,
+        cell_partitioninfo,       // lists of which cells to send to which process
+        this->MigrateLists.known, // list of which points to send to which process
+        this->LoadBalanceData     // the partition information generated during PartitionPoints
+      );
+    }
+    else if (this->ZoltanCallbackData.PointType==VTK_DOUBLE) {
+      this->BuildCellToProcessList<double>(
+        this->ZoltanCallbackData.Input,
+        cell_partitioninfo,       // lists of which cells to send to which process
+        this->MigrateLists.known, // list of which points to send to which process
+        this->LoadBalanceData     // the partition information generated during PartitionPoints
+      );
+    }
 
-  //*****************************************************************
-  // Free the arrays allocated by Zoltan_LB_Partition
-  // before we do a manual migration.
-  //*****************************************************************
-  vtkDebugMacro("Freeing Zoltan LB arrays");
-  // Zoltan_LB_Free_Part(&this->LoadBalanceData.importGlobalGids, &this->LoadBalanceData.importLocalGids, &this->LoadBalanceData.importProcs, &this->LoadBalanceData.importToPart);
-  // Zoltan_LB_Free_Part(&this->LoadBalanceData.exportGlobalGids, &this->LoadBalanceData.exportLocalGids, &this->LoadBalanceData.exportProcs, &this->LoadBalanceData.exportToPart);
+    //*****************************************************************
+    // Free the arrays allocated by Zoltan_LB_Partition
+    // before we do a manual migration.
+    //*****************************************************************
+    vtkDebugMacro("Freeing Zoltan LB arrays");
+    // Zoltan_LB_Free_Part(&this->LoadBalanceData.importGlobalGids, &this->LoadBalanceData.importLocalGids, &this->LoadBalanceData.importProcs, &this->LoadBalanceData.importToPart);
+    // Zoltan_LB_Free_Part(&this->LoadBalanceData.exportGlobalGids, &this->LoadBalanceData.exportLocalGids, &this->LoadBalanceData.exportProcs, &this->LoadBalanceData.exportToPart);
 
-  //
-  // Based on the original partition and our extra cell point allocations
-  // perform the main point exchange between all processes
-  //
-  this->ComputeInvertLists(this->MigrateLists);
+    //
+    // Based on the original partition and our extra cell point allocations
+    // perform the main point exchange between all processes
+    //
+    this->ComputeInvertLists(this->MigrateLists);
 
-  this->ManualPointMigrate(this->MigrateLists, this->KeepInversePointLists==1);
+    this->ManualPointMigrate(this->MigrateLists, this->KeepInversePointLists==1);
 
 
-  if (!this->KeepInversePointLists) {
-    vtkDebugMacro("Release point exchange data");
-    this->MigrateLists.known.GlobalIds.clear();
-    this->MigrateLists.known.Procs.clear();
-    this->MigrateLists.known.LocalIdsToKeep.clear();
-  }
+    if (!this->KeepInversePointLists) {
+      vtkDebugMacro("Release point exchange data");
+      this->MigrateLists.known.GlobalIds.clear();
+      this->MigrateLists.known.Procs.clear();
+      this->MigrateLists.known.LocalIdsToKeep.clear();
+    }
 
-  if (this->InputDisposable) {
-    vtkDebugMacro("Disposing of input points and point data");
-    this->ZoltanCallbackData.Input->SetPoints(NULL);
-    this->ZoltanCallbackData.Input->GetPointData()->Initialize();
-  }
+    if (this->InputDisposable) {
+      vtkDebugMacro("Disposing of input points and point data");
+      this->ZoltanCallbackData.Input->SetPoints(NULL);
+      this->ZoltanCallbackData.Input->GetPointData()->Initialize();
+    }
 
-  // after deleting memory, add a barrier to let ranks free as much as possible before the next big allocation
-  this->Controller->Barrier();
+    // after deleting memory, add a barrier to let ranks free as much as possible before the next big allocation
+    this->Controller->Barrier();
+
+    //
+    // Distribute cells based on the usage of the points already distributed
+    //
+    this->PartitionCells(cell_partitioninfo);
+  }
 
   //
   // Distribute cells based on the usage of the points already distributed
   //
-  this->PartitionCells(cell_partitioninfo);
+  this->UnmarkInvalidGhostCells(this->ZoltanCallbackData.Output);
 
   //
-  // Distribute cells based on the usage of the points already distributed
+  // ghost cells of all processes, part of the partition quality
   //
-  this->UnmarkInvalidGhostCells(this->ZoltanCallbackData.Output);
+  vtkUnsignedCharArray *ghostTypes = vtkUnsignedCharArray::SafeDownCast(
+    this->ZoltanCallbackData.Output->GetCellData()->GetArray("vtkGhostType"));
+  vtkIdType ghostCells = 0;
+  for (vtkIdType i=0; ghostTypes && i<ghostTypes->GetNumberOfTuples(); ++i) {
+    ghostCells += (ghostTypes->GetValue(i)!=0);
+  }
+  this->Controller->AllReduce(&ghostCells, &this->NumberOfGhostCells, 1, vtkCommunicator::SUM_OP);
 
   //
   // build a tree of bounding boxes to use for rendering info/hints or other spatial tests
   //
-#ifdef VTK_ZOLTAN1_PARTITION_FILTER
   vtkDebugMacro("Create KdTree");
   this->CreatePkdTree();
   this->ExtentTranslator->SetKdTree(this->GetKdtree());
-#endif
+  this->PieceExtentTranslator->SetKdTree(this->GetKdtree());
 
   //*****************************************************************
   // Free the storage allocated for the Zoltan structure.
   //*****************************************************************
   if (!this->KeepInversePointLists) {
-    vtkDebugMacro("Zoltan_Destroy");
-    Zoltan_Destroy(&this->ZoltanData);
-    this->ZoltanData = NULL;
+    this->ReleaseZoltanData();
   }
 
+  // one block per local piece on the second output
+  this->ExtractPieces(this->ZoltanCallbackData.Output, vtkMultiBlockDataSet::GetData(outputVector, 1));
+
   this->Timer->StopTimer();
   vtkDebugMacro("Mesh partitioning : " << this->Timer->GetElapsedTime() << " seconds");
+  vtkDebugMacro("Mesh partition quality : "
+      << " shared points " << this->NumberOfSharedPoints
+      << " split cells " << this->NumberOfSplitCells
+      << " duplicated points " << this->NumberOfDuplicatedPoints
+      << " ghost cells " << this->NumberOfGhostCells);
   return 1;
 }
+
 //----------------------------------------------------------------------------
-int vtkMeshPartitionFilter::PartitionCells(PartitionInfo &cell_partitioninfo)
+void vtkMeshPartitionFilter::ExecuteZoltanPartition(vtkPointSet *output, vtkPointSet *input)
+{
+  if (this->PartitionMode==vtkMeshPartitionFilter::Points) {
+    this->Superclass::ExecuteZoltanPartition(output, input);
+    return;
+  }
+
+  // cells are partitioned into one part per process
+  if (this->PartsPerProcess>1) {
+    vtkWarningMacro("PiecesPerProcess is only supported when partitioning points, using one piece per process");
+    this->PartsPerProcess = 1;
+    this->NumberOfParts   = this->UpdateNumPieces;
+    this->ExtentTranslator->SetNumberOfPieces(this->NumberOfParts);
+  }
+  this->BuildCellGraph(input);
+  this->ComputeCellDestinations(input);
+
+  //
+  // each point follows the first cell using it, BuildCellToProcessList
+  // will send copies to the destinations of the other cells
+  //
+  vtkIdType numPts = input->GetNumberOfPoints();
+  std::vector<int> parts(numPts, this->UpdatePiece);
+  for (vtkIdType i=0; i<numPts; ++i) {
+    if (this->PointCellOffsets[i]<this->PointCellOffsets[i+1]) {
+      parts[i] = this->CellDestinations[this->PointCellIds[this->PointCellOffsets[i]]];
+    }
+  }
+  this->SetExportListsFromParts(parts);
+
+  // imbalance of the cell partition
+  std::vector<vtkIdType> counts(this->UpdateNumPieces, 0), globalCounts(this->UpdateNumPieces, 0);
+  for (size_t c=0; c<this->CellDestinations.size(); ++c) {
+    counts[this->CellDestinations[c]]++;
+  }
+  this->Controller->AllReduce(&counts[0], &globalCounts[0], this->UpdateNumPieces, vtkCommunicator::SUM_OP);
+  vtkIdType total = std::accumulate(globalCounts.begin(), globalCounts.end(), static_cast<vtkIdType>(0));
+  vtkIdType most  = *std::max_element(globalCounts.begin(), globalCounts.end());
+  this->ImbalanceValue = total>0 ? static_cast<float>(most)*this->UpdateNumPieces/total : 1.0f;
+
+  // the graph is not needed any more
+  std::vector<vtkIdType>().swap(this->PointCellOffsets);
+  std::vector<vtkIdType>().swap(this->PointCellIds);
+  std::vector<vtkIdType>().swap(this->CellGraphOffsets);
+  std::vector<vtkIdType>().swap(this->CellGraphAdjacency);
+  std::vector<float>().swap(this->CellGraphWeights);
+}
+
+//----------------------------------------------------------------------------
+void vtkMeshPartitionFilter::GetZoltanBoundingBoxes(vtkBoundingBox &globalBounds)
+{
+  if (this->PartitionMode==vtkMeshPartitionFilter::Points) {
+    this->Superclass::GetZoltanBoundingBoxes(globalBounds);
+    return;
+  }
+  // cell partitions are not boxes, use the bounds of the assigned points
+  this->ComputePartitionBoundingBoxes(globalBounds);
+}
+
+//----------------------------------------------------------------------------
+vtkSmartPointer<vtkPKdTree> vtkMeshPartitionFilter::CreatePkdTree()
+{
+  // there is no tree of cuts when cells are partitioned using the graph
+  if (this->PartitionMode!=vtkMeshPartitionFilter::Points) {
+    this->KdTree = NULL;
+    return NULL;
+  }
+  return this->Superclass::CreatePkdTree();
+}
+
+//----------------------------------------------------------------------------
+void vtkMeshPartitionFilter::BuildCellGraph(vtkPointSet *data)
+{
+  vtkIdType numPts   = data->GetNumberOfPoints();
+  vtkIdType numCells = data->GetNumberOfCells();
+  vtkIdType npts, *pts;
+  vtkPolyData         *pdata = vtkPolyData::SafeDownCast(data);
+  vtkUnstructuredGrid *udata = vtkUnstructuredGrid::SafeDownCast(data);
+  if (!pdata && !udata) {
+    vtkErrorMacro("Only PolyData and UnstructuredGrid supported so far");
+    return;
+  }
+  if (pdata) pdata->BuildCells();
+
+  //
+  // point to cell links, counted then filled
+  //
+  this->PointCellOffsets.assign(numPts+1, 0);
+  for (vtkIdType cellId=0; cellId<numCells; ++cellId) {
+    if (pdata) { pdata->GetCellPoints(cellId, npts, pts); }
+    else { udata->GetCellPoints(cellId, npts, pts); }
+    for (int j=0; j<npts; ++j) {
+      this->PointCellOffsets[pts[j]+1]++;
+    }
+  }
+  std::partial_sum(this->PointCellOffsets.begin(), this->PointCellOffsets.end(), this->PointCellOffsets.begin());
+  this->PointCellIds.resize(this->PointCellOffsets[numPts]);
+  std::vector<vtkIdType> next(this->PointCellOffsets.begin(), this->PointCellOffsets.end()-1);
+  for (vtkIdType cellId=0; cellId<numCells; ++cellId) {
+    if (pdata) { pdata->GetCellPoints(cellId, npts, pts); }
+    else { udata->GetCellPoints(cellId, npts, pts); }
+    for (int j=0; j<npts; ++j) {
+      this->PointCellIds[next[pts[j]]++] = cellId;
+    }
+  }
+
+  if (this->PartitionMode!=vtkMeshPartitionFilter::CellGraph) {
+    return;
+  }
+
+  //
+  // cells are neighbours when they share points, the edge weight is the number
+  // of shared points so that cutting across faces costs more than across vertices
+  //
+  this->CellGraphOffsets.assign(numCells+1, 0);
+  this->CellGraphAdjacency.clear();
+  this->CellGraphWeights.clear();
+  std::vector<vtkIdType> marker(numCells, -1), position(numCells, 0);
+  for (vtkIdType cellId=0; cellId<numCells; ++cellId) {
+    if (pdata) { pdata->GetCellPoints(cellId, npts, pts); }
+    else { udata->GetCellPoints(cellId, npts, pts); }
+    for (int j=0; j<npts; ++j) {
+      for (vtkIdType k=this->PointCellOffsets[pts[j]]; k<this->PointCellOffsets[pts[j]+1]; ++k) {
+        vtkIdType nbr = this->PointCellIds[k];
+        if (nbr==cellId) {
+          continue;
+        }
+        if (marker[nbr]!=cellId) {
+          marker[nbr]   = cellId;
+          position[nbr] = this->CellGraphAdjacency.size();
+          this->CellGraphAdjacency.push_back(nbr);
+          this->CellGraphWeights.push_back(1.0f);
+        }
+        else {
+          this->CellGraphWeights[position[nbr]] += 1.0f;
+        }
+      }
+    }
+    this->CellGraphOffsets[cellId+1] = this->CellGraphAdjacency.size();
+  }
+  vtkDebugMacro("Cell graph : " << numCells << " cells " << this->CellGraphAdjacency.size() << " edges");
+}
+
+//----------------------------------------------------------------------------
+void vtkMeshPartitionFilter::ComputeCellDestinations(vtkPointSet *data)
+{
+  vtkIdType numCells = data->GetNumberOfCells();
+  //
+  // a separate structure is used, the point structure is still needed for migration
+  //
+  struct Zoltan_Struct *zz = Zoltan_Create(this->GetMPIComm());
+  Zoltan_Set_Param(zz, "DEBUG_LEVEL", "0");
+  Zoltan_Set_Param(zz, "NUM_GID_ENTRIES", "1");
+  Zoltan_Set_Param(zz, "NUM_LID_ENTRIES", "0");
+  Zoltan_Set_Param(zz, "OBJ_WEIGHT_DIM", "0");
+  Zoltan_Set_Param(zz, "RETURN_LISTS", "EXPORT");
+  Zoltan_Set_Param(zz, "LB_APPROACH",
+    (this->IncrementalPartitioning || this->MigrationCostAware) ? "REPARTITION" : "PARTITION");
+  if (this->MigrationCostAware) {
+    // PHG trades the edge cut against the bytes moved from the current
+    // distribution, the geometric methods only use the remap
+    std::stringstream multiplier;
+    multiplier << this->RepartitionMultiplier << std::ends;
+    this->ComputeCellBytes(data);
+    Zoltan_Set_Obj_Size_Multi_Fn(zz, get_object_sizes_cells, this);
+    Zoltan_Set_Param(zz, "PHG_REPART_MULTIPLIER", multiplier.str().c_str());
+    Zoltan_Set_Param(zz, "REMAP", "1");
+  }
+  //
+  Zoltan_Set_Num_Obj_Fn(zz, get_number_of_objects_cells, this);
+  Zoltan_Set_Obj_List_Fn(zz, get_object_list_cells, this);
+  if (this->PartitionMode==vtkMeshPartitionFilter::CellGraph) {
+    Zoltan_Set_Param(zz, "LB_METHOD", "GRAPH");
+    Zoltan_Set_Param(zz, "GRAPH_PACKAGE", "PHG");
+    Zoltan_Set_Param(zz, "EDGE_WEIGHT_DIM", "1");
+    Zoltan_Set_Num_Edges_Multi_Fn(zz, get_num_edges_list_cells, this);
+    Zoltan_Set_Edge_List_Multi_Fn(zz, get_edge_list_cells, this);
+  }
+  else if (this->PartitionMode==vtkMeshPartitionFilter::CellCentroid) {
+    switch (this->PartitionMethod) {
+      case vtkZoltanBasePartitionFilter::RIB:
+        Zoltan_Set_Param(zz, "LB_METHOD", "RIB");
+        break;
+      case vtkZoltanBasePartitionFilter::HSFC:
+        Zoltan_Set_Param(zz, "LB_METHOD", "HSFC");
+        break;
+      default:
+        Zoltan_Set_Param(zz, "LB_METHOD", "RCB");
+        break;
+    }
+    Zoltan_Set_Param(zz, "RCB_OUTPUT_LEVEL", "0");
+    Zoltan_Set_Num_Geom_Fn(zz, get_num_geometry, this);
+    if (this->ZoltanCallbackData.PointType==VTK_FLOAT) {
+      Zoltan_Set_Geom_Multi_Fn(zz, get_geometry_list_cells<float>, this);
+    }
+    else if (this->ZoltanCallbackData.PointType==VTK_DOUBLE) {
+      Zoltan_Set_Geom_Multi_Fn(zz, get_geometry_list_cells<double>, this);
+    }
+  }
+  else {
+    Zoltan_Set_Param(zz, "LB_METHOD", "HYPERGRAPH");
+    Zoltan_Set_Param(zz, "HYPERGRAPH_PACKAGE", "PHG");
+    Zoltan_Set_Param(zz, "EDGE_WEIGHT_DIM", "0");
+    Zoltan_Set_HG_Size_CS_Fn(zz, get_hypergraph_size_cells, this);
+    Zoltan_Set_HG_CS_Fn(zz, get_hypergraph_cells, this);
+  }
+
+  ZoltanLoadBalanceData lb;
+  int zoltan_error = Zoltan_LB_Partition(zz,
+    &lb.changes, &lb.numGidEntries, &lb.numLidEntries,
+    &lb.numImport, &lb.importGlobalGids, &lb.importLocalGids, &lb.importProcs, &lb.importToPart,
+    &lb.numExport, &lb.exportGlobalGids, &lb.exportLocalGids, &lb.exportProcs, &lb.exportToPart);
+
+  if (zoltan_error != ZOLTAN_OK) {
+    printf("Zoltan_LB_Partition NOT OK (cells)...\n");
+    MPI_Finalize();
+    Zoltan_Destroy(&zz);
+    exit(0);
+  }
+
+  vtkIdType offset = this->ZoltanCallbackData.ProcessOffsetsCellId[this->ZoltanCallbackData.ProcessRank];
+  this->CellDestinations.assign(numCells, this->UpdatePiece);
+  for (int i=0; i<lb.numExport; ++i) {
+    this->CellDestinations[lb.exportGlobalGids[i] - offset] = lb.exportProcs[i];
+  }
+  vtkDebugMacro("Cell partition : export " << lb.numExport << " of " << numCells << " cells");
+
+  Zoltan_LB_Free_Part(&lb.importGlobalGids, &lb.importLocalGids, &lb.importProcs, &lb.importToPart);
+  Zoltan_LB_Free_Part(&lb.exportGlobalGids, &lb.exportLocalGids, &lb.exportProcs, &lb.exportToPart);
+  Zoltan_Destroy(&zz);
+  std::vector<int>().swap(this->CellBytes);
+}
+
+//----------------------------------------------------------------------------
+void vtkMeshPartitionFilter::ComputeCellBytes(vtkPointSet *data)
+{
+  vtkIdType numCells = data->GetNumberOfCells();
+  vtkIdType npts, *pts;
+  vtkPolyData         *pdata = vtkPolyData::SafeDownCast(data);
+  vtkUnstructuredGrid *udata = vtkUnstructuredGrid::SafeDownCast(data);
+  //
+  int cellFieldBytes = 0;
+  vtkCellData *cellData = data->GetCellData();
+  for (int i=0; i<cellData->GetNumberOfArrays(); ++i) {
+    vtkDataArray *array = cellData->GetArray(i);
+    if (array) {
+      cellFieldBytes += array->GetNumberOfComponents()*array->GetDataTypeSize();
+    }
+  }
+  // the point to cell links are built by BuildCellGraph
+  this->CellBytes.assign(numCells, 0);
+  for (vtkIdType cellId=0; cellId<numCells; ++cellId) {
+    if (pdata) { pdata->GetCellPoints(cellId, npts, pts); }
+    else if (udata) { udata->GetCellPoints(cellId, npts, pts); }
+    else { npts = 0; }
+    double pointShare = 0.0;
+    for (vtkIdType j=0; j<npts; ++j) {
+      vtkIdType users = this->PointCellOffsets[pts[j]+1] - this->PointCellOffsets[pts[j]];
+      pointShare += static_cast<double>(this->PointBytes)/std::max(users, static_cast<vtkIdType>(1));
+    }
+    this->CellBytes[cellId] = cellFieldBytes + static_cast<int>((npts+1)*sizeof(vtkIdType) + pointShare + 0.5);
+  }
+}
+//----------------------------------------------------------------------------
+int vtkMeshPartitionFilter::PartitionCells(PartitionInfo &cell_partitioninfo, bool carryPoints)
 {
   vtkDebugMacro("Entering PartitionCells");
 
@@ -660,27 +1243,119 @@ int vtkMeshPartitionFilter::PartitionCells(PartitionInfo &cell_partitioninfo)
   zpack_fn  f2 = zoltan_pack_obj_function_cell;
   zupack_fn f3 = zoltan_unpack_obj_function_cell;
   zprem_fn  f4 = zoltan_pre_migrate_function_cell<float>;
+  if (carryPoints && this->ZoltanCallbackData.PointType==VTK_FLOAT) {
+    f1 = zoltan_obj_size_function_cell_points<float>;
+    f2 = zoltan_pack_obj_function_cell_points<float>;
+    f3 = zoltan_unpack_obj_function_cell_points<float>;
+  }
+  else if (carryPoints && this->ZoltanCallbackData.PointType==VTK_DOUBLE) {
+    f1 = zoltan_obj_size_function_cell_points<double>;
+    f2 = zoltan_pack_obj_function_cell_points<double>;
+    f3 = zoltan_unpack_obj_function_cell_points<double>;
+  }
   Zoltan_Set_Fn(this->ZoltanData, ZOLTAN_OBJ_SIZE_FN_TYPE,       (void (*)()) f1, &this->ZoltanCallbackData);
   Zoltan_Set_Fn(this->ZoltanData, ZOLTAN_PACK_OBJ_FN_TYPE,       (void (*)()) f2, &this->ZoltanCallbackData);
   Zoltan_Set_Fn(this->ZoltanData, ZOLTAN_UNPACK_OBJ_FN_TYPE,     (void (*)()) f3, &this->ZoltanCallbackData);
   Zoltan_Set_Fn(this->ZoltanData, ZOLTAN_PRE_MIGRATE_PP_FN_TYPE, (void (*)()) f4, &this->ZoltanCallbackData);
+  ClearMultiMigrateFunctions(this->ZoltanData);
 
   //
   // Perform the cell exchange
   //
-  vtkDebugMacro("About to Zoltan_Migrate (cells)");
-  zoltan_error = Zoltan_Migrate (this->ZoltanData,
-    (int)num_found,
-    found_global_ids,
-    found_local_ids,
-    found_procs,
-    found_to_part,
-    (int)num_known,
-    num_known>0 ? &cell_partitioninfo.GlobalIds[0] : NULL,
-    NULL,
-    num_known>0 ? &cell_partitioninfo.Procs[0]     : NULL,
-    NULL
-    );
+  if (this->MaxMigrationBufferBytes==0) {
+    vtkDebugMacro("About to Zoltan_Migrate (cells)");
+    zoltan_error = Zoltan_Migrate (this->ZoltanData,
+      (int)num_found,
+      found_global_ids,
+      found_local_ids,
+      found_procs,
+      found_to_part,
+      (int)num_known,
+      num_known>0 ? &cell_partitioninfo.GlobalIds[0] : NULL,
+      NULL,
+      num_known>0 ? &cell_partitioninfo.Procs[0]     : NULL,
+      NULL
+      );
+  }
+  else {
+    //
+    // the cells sent are split into slices whose packed size stays within
+    // MaxMigrationBufferBytes (a slice holds at least one cell), and one
+    // Zoltan_Migrate is done per slice, all processes doing the same number
+    //
+    std::vector<size_t> sliceStart(1, 0);
+    vtkIdType sliceBytes = 0, peakBytes = 0;
+    for (size_t i=0; i<num_known; ++i) {
+      int ierr;
+      vtkIdType bytes = f1(&this->ZoltanCallbackData, 1, 0, &cell_partitioninfo.GlobalIds[i], NULL, &ierr);
+      if (sliceBytes>0 && sliceBytes+bytes>this->MaxMigrationBufferBytes) {
+        sliceStart.push_back(i);
+        peakBytes  = std::max(peakBytes, sliceBytes);
+        sliceBytes = 0;
+      }
+      sliceBytes += bytes;
+    }
+    peakBytes = std::max(peakBytes, sliceBytes);
+    sliceStart.push_back(num_known);
+    int rounds = static_cast<int>(sliceStart.size()) - 1, maxRounds = 0;
+    this->Controller->AllReduce(&rounds, &maxRounds, 1, vtkCommunicator::MAX_OP);
+    this->UpdatePeakMigrationBuffer(peakBytes);
+    this->NumberOfMigrationRounds = std::max(this->NumberOfMigrationRounds, maxRounds);
+    //
+    // the output is allocated (and the kept cells copied) once for all the
+    // cells received, the unpack callbacks append the cells of each slice
+    //
+    int ierr;
+    f4(&this->ZoltanCallbackData, 1, 0,
+      num_found, found_global_ids, found_local_ids, found_procs, found_to_part,
+      (int)num_known,
+      num_known>0 ? &cell_partitioninfo.GlobalIds[0] : NULL,
+      NULL,
+      num_known>0 ? &cell_partitioninfo.Procs[0]     : NULL,
+      NULL, &ierr);
+    Zoltan_Set_Fn(this->ZoltanData, ZOLTAN_PRE_MIGRATE_PP_FN_TYPE, NULL, NULL);
+    vtkDebugMacro("About to Zoltan_Migrate (cells) in " << maxRounds << " rounds");
+    for (int r=0; r<maxRounds && zoltan_error==ZOLTAN_OK; ++r) {
+      size_t b0 = sliceStart[std::min(r, rounds)];
+      size_t b1 = sliceStart[std::min(r+1, rounds)];
+      int    n  = static_cast<int>(b1-b0);
+      int           slice_found = 0;
+      ZOLTAN_ID_PTR slice_global_ids = NULL;
+      ZOLTAN_ID_PTR slice_local_ids  = NULL;
+      int          *slice_procs      = NULL;
+      int          *slice_to_part    = NULL;
+      zoltan_error = Zoltan_Invert_Lists(this->ZoltanData,
+        n,
+        n>0 ? &cell_partitioninfo.GlobalIds[b0] : NULL,
+        NULL,
+        n>0 ? &cell_partitioninfo.Procs[b0]     : NULL,
+        NULL,
+        &slice_found,
+        &slice_global_ids,
+        &slice_local_ids,
+        &slice_procs,
+        &slice_to_part);
+      if (zoltan_error==ZOLTAN_OK) {
+        zoltan_error = Zoltan_Migrate (this->ZoltanData,
+          slice_found,
+          slice_global_ids,
+          slice_local_ids,
+          slice_procs,
+          slice_to_part,
+          n,
+          n>0 ? &cell_partitioninfo.GlobalIds[b0] : NULL,
+          NULL,
+          n>0 ? &cell_partitioninfo.Procs[b0]     : NULL,
+          NULL
+          );
+      }
+      Zoltan_LB_Free_Part(
+        &slice_global_ids,
+        &slice_local_ids,
+        &slice_procs,
+        &slice_to_part);
+    }
+  }
 
   //
   // Release the arrays allocated during Zoltan_Invert_Lists
@@ -698,6 +1373,75 @@ int vtkMeshPartitionFilter::PartitionCells(PartitionInfo &cell_partitioninfo)
   cell_partitioninfo.Procs.clear();
   this->ZoltanCallbackData.LocalIdsToKeep.clear();
 
+  //
+  // cells which carried points were held back until all points had arrived
+  //
+  if (carryPoints) {
+    vtkPolyData *pdata2 = vtkPolyData::SafeDownCast(ZoltanCallbackData.Output);
+    int *cellTypes = ZoltanCallbackData.OutputUnstructuredCellTypes;
+    // the received cells are the last ones, in the order they were unpacked
+    vtkIdType numPending = 0;
+    for (size_t k=0; k<this->PendingCells.size(); k += 2 + this->PendingCells[k]) {
+      numPending++;
+    }
+    vtkIdType readId  = ZoltanCallbackData.OutCellCount - numPending;
+    vtkIdType writeId = readId;
+    std::vector<vtkIdType> newPts;
+    for (size_t k=0; k<this->PendingCells.size(); ) {
+      vtkIdType npts  = this->PendingCells[k];
+      int       ctype = static_cast<int>(this->PendingCells[k+1]);
+      bool complete = true;
+      newPts.resize(npts);
+      for (vtkIdType i=0; i<npts && complete; ++i) {
+        std::unordered_map<vtkIdType,vtkIdType>::iterator it = this->ReceivedPointIds.find(this->PendingCells[k+2+i]);
+        if (it==this->ReceivedPointIds.end()) {
+          vtkErrorMacro("Received cell uses point " << this->PendingCells[k+2+i] << " which was not received, the cell is dropped");
+          complete = false;
+        }
+        else {
+          newPts[i] = it->second;
+        }
+      }
+      if (!complete) {
+        // a dropped cell is reported as split, its data is overwritten by the next cell
+        this->DroppedCells++;
+      }
+      else {
+        if (writeId!=readId) {
+          for (int f=0; f<ZoltanCallbackData.NumberOfFields; f++) {
+            int asize = ZoltanCallbackData.MemoryPerTuple[f];
+            char *fieldptr = (char*)(ZoltanCallbackData.OutputArrayPointers[f]);
+            memcpy(fieldptr + asize*writeId, fieldptr + asize*readId, asize);
+          }
+          if (cellTypes) {
+            cellTypes[writeId] = cellTypes[readId];
+          }
+        }
+        if (pdata2) {
+          pdata2->InsertNextCell(ctype, npts, npts>0 ? &newPts[0] : NULL);
+        }
+        else {
+          ZoltanCallbackData.OutputUnstructuredCellArray->InsertNextCell(npts, npts>0 ? &newPts[0] : NULL);
+        }
+        writeId++;
+      }
+      readId++;
+      k += 2 + npts;
+    }
+    if (writeId!=readId) {
+      vtkCellData *outCD = ZoltanCallbackData.Output->GetCellData();
+      for (int a=0; a<outCD->GetNumberOfArrays(); a++) {
+        outCD->GetArray(a)->SetNumberOfTuples(writeId);
+      }
+      if (this->ghost_cell_out_rank) {
+        this->ghost_cell_out_rank->SetNumberOfTuples(writeId);
+      }
+      ZoltanCallbackData.OutCellCount = writeId;
+    }
+    std::vector<vtkIdType>().swap(this->PendingCells);
+    std::unordered_map<vtkIdType,vtkIdType>().swap(this->ReceivedPointIds);
+  }
+
   // For UnstructuredGrids, we must put the cells into the actual output dataset
   // It happens at the end with UnstructuredGrid because we manaully set the cell
   // array/types, whereas with polydata we use InsertNextCell at the dataset layer.
@@ -772,6 +1516,10 @@ void vtkMeshPartitionFilter::BuildCellToProcessList(
     std::vector< process_tuple > cellDestProcesses;
     cellDestProcesses.reserve(this->UpdateNumPieces);
 
+    // final destination of each cell, used for the partition quality
+    std::vector<int> cellParts(numCells, this->UpdatePiece);
+    vtkIdType splitCells = 0;
+
 
     // before iterating over cells, compute BBoxes if we need them
     double bounds[6];
@@ -864,7 +1612,24 @@ void vtkMeshPartitionFilter::BuildCellToProcessList(
         bool cell_being_sent = false;
         //
         CellStatus cellstatus = UNDEFINED;
-        if (points_remote==0) {
+        if (!this->CellDestinations.empty()) {
+            // the cells were partitioned, classify relative to the cell destination
+            cellDestProcess = this->CellDestinations[cellId];
+            if (process_flag[cellDestProcess]==static_cast<unsigned int>(npts)) {
+                cellstatus = (cellDestProcess==this->UpdatePiece) ? LOCAL : SAME;
+            }
+            else if (points_remote<npts) {
+                cellstatus = SPLIT;
+            }
+            else {
+                cellstatus = SCATTERED;
+            }
+            if (cellDestProcess!=this->UpdatePiece) {
+                cell_being_sent = true;
+                cellDestProcesses.push_back( process_tuple(cellId, cellDestProcess) );
+            }
+        }
+        else if (points_remote==0) {
             cellstatus = LOCAL;
         }
         else {
@@ -906,6 +1671,11 @@ void vtkMeshPartitionFilter::BuildCellToProcessList(
             }
         }
 
+        cellParts[cellId] = cellDestProcess;
+        if (cellstatus==SPLIT || cellstatus==SCATTERED) {
+            splitCells++;
+        }
+
         // step 5: any *_points_* which belong to a cell marked for sending, but are not already
         // marked for sending themselves, must be marked for both local and remote handling
         if (cellstatus==SAME && this->GhostMode==vtkMeshPartitionFilter::Boundary) {
@@ -1092,10 +1862,227 @@ void vtkMeshPartitionFilter::BuildCellToProcessList(
         " numImport : " << this->LoadBalanceData.numImport <<
         " numExport : " << point_partitioninfo.GlobalIds .size()
     );
+
+    //
+    // partition quality : split cells and the extra point copies needed to complete the cells
+    //
+    this->ComputePartitionQuality(data, cellParts, splitCells,
+        process_vector.size() + point_partitioninfo.LocalIdsToKeep.size());
     //debug::output_sync("cell_partitioninfo GlobalIds", cell_partitioninfo.GlobalIds, this->UpdateNumPieces, this->UpdatePiece, this->Controller);
     //debug::output_sync("cell_partitioninfo Procs", cell_partitioninfo.Procs, this->UpdateNumPieces, this->UpdatePiece, this->Controller);
 }
 
+//----------------------------------------------------------------------------
+void vtkMeshPartitionFilter::ComputePartitionQuality(vtkPointSet *data,
+  const std::vector<int> &cellParts, vtkIdType splitCells, vtkIdType duplicatedPoints)
+{
+    vtkIdType numPts   = data->GetNumberOfPoints();
+    vtkIdType numCells = data->GetNumberOfCells();
+    vtkIdType npts, *pts;
+    vtkPolyData         *pdata = vtkPolyData::SafeDownCast(data);
+    vtkUnstructuredGrid *udata = vtkUnstructuredGrid::SafeDownCast(data);
+    //
+    // shared points are used by cells going to different processes, only
+    // the local point Ids are known so this is a per input piece count
+    //
+    std::vector<int>  pointPart(numPts, -1);
+    std::vector<char> pointCut(numPts, 0);
+    for (vtkIdType cellId=0; cellId<numCells; ++cellId) {
+        if (pdata) { pdata->GetCellPoints(cellId, npts, pts); }
+        else if (udata) { udata->GetCellPoints(cellId, npts, pts); }
+        for (int j=0; j<npts; ++j) {
+            if (pointPart[pts[j]]==-1) {
+                pointPart[pts[j]] = cellParts[cellId];
+            }
+            else if (pointPart[pts[j]]!=cellParts[cellId]) {
+                pointCut[pts[j]] = 1;
+            }
+        }
+    }
+    vtkIdType quality[3], globalQuality[3];
+    quality[0] = std::count(pointCut.begin(), pointCut.end(), 1);
+    quality[1] = splitCells;
+    quality[2] = duplicatedPoints;
+    this->Controller->AllReduce(quality, globalQuality, 3, vtkCommunicator::SUM_OP);
+    this->NumberOfSharedPoints     = globalQuality[0];
+    this->NumberOfSplitCells       = globalQuality[1];
+    this->NumberOfDuplicatedPoints = globalQuality[2];
+}
+
+//----------------------------------------------------------------------------
+//
+// Single phase migration : every cell is sent once to its destination, the
+// first cell sent to a process which uses a point carries that point (and its
+// data) with it. Points used by local cells, or by no cell, stay here.
+// No point export lists, invert lists or LocalIdsToKeep are needed.
+//
+template <typename T>
+void vtkMeshPartitionFilter::MigrateCellsSinglePhase()
+{
+    CallbackData *callbackdata = &this->ZoltanCallbackData;
+    vtkPointSet *data = callbackdata->Input;
+    vtkIdType numPts   = data->GetNumberOfPoints();
+    vtkIdType numCells = data->GetNumberOfCells();
+    vtkIdType cellOffset = callbackdata->ProcessOffsetsCellId[this->UpdatePiece];
+    vtkIdType npts, *pts;
+    vtkPolyData         *pdata = vtkPolyData::SafeDownCast(data);
+    vtkUnstructuredGrid *udata = vtkUnstructuredGrid::SafeDownCast(data);
+    if (!pdata && !udata) {
+        vtkErrorMacro("Only PolyData and UnstructuredGrid supported so far");
+        return;
+    }
+    if (pdata) pdata->BuildCells();
+
+    //
+    // 1) connectivity offsets of each cell, the points we keep,
+    // and one {point, destination, connectivity index} entry for each remote use
+    //
+    typedef std::tuple<vtkIdType, int, vtkIdType> point_use;
+    std::vector<point_use> remoteUses;
+    std::vector<char> keepPoint(numPts, 0), usedPoint(numPts, 0);
+    this->CellPointOffsets.assign(numCells+1, 0);
+    for (vtkIdType cellId=0; cellId<numCells; ++cellId) {
+        if (pdata) { pdata->GetCellPoints(cellId, npts, pts); }
+        else { udata->GetCellPoints(cellId, npts, pts); }
+        int dest = this->CellDestinations[cellId];
+        for (int j=0; j<npts; ++j) {
+            usedPoint[pts[j]] = 1;
+            if (dest==this->UpdatePiece) {
+                keepPoint[pts[j]] = 1;
+            }
+            else {
+                remoteUses.push_back(point_use(pts[j], dest, this->CellPointOffsets[cellId]+j));
+            }
+        }
+        this->CellPointOffsets[cellId+1] = this->CellPointOffsets[cellId] + npts;
+    }
+    // points used by no cell are not moved
+    for (vtkIdType i=0; i<numPts; ++i) {
+        if (!usedPoint[i]) keepPoint[i] = 1;
+    }
+
+    //
+    // 2) the first use of each point by each destination carries the point
+    //
+    std::sort(remoteUses.begin(), remoteUses.end());
+    this->CarryPoint.assign(this->CellPointOffsets[numCells], 0);
+    std::vector<int> sendCounts(this->UpdateNumPieces, 0), recvCounts(this->UpdateNumPieces, 0);
+    vtkIdType carried = 0;
+    for (size_t i=0; i<remoteUses.size(); ++i) {
+        if (i==0 ||
+            std::get<0>(remoteUses[i])!=std::get<0>(remoteUses[i-1]) ||
+            std::get<1>(remoteUses[i])!=std::get<1>(remoteUses[i-1]))
+        {
+            this->CarryPoint[std::get<2>(remoteUses[i])] = 1;
+            sendCounts[std::get<1>(remoteUses[i])]++;
+            carried++;
+        }
+    }
+    std::vector<point_use>().swap(remoteUses);
+    // every process needs to know how many points it will receive to allocate them
+#ifdef VTK_USE_MPI
+    MPI_Alltoall(&sendCounts[0], 1, MPI_INT, &recvCounts[0], 1, MPI_INT, this->GetMPIComm());
+#endif
+    vtkIdType numKept  = std::count(keepPoint.begin(), keepPoint.end(), 1);
+    vtkIdType numFinal = numKept + std::accumulate(recvCounts.begin(), recvCounts.end(), static_cast<vtkIdType>(0));
+
+    //
+    // 3) allocate the output points, copy the kept ones. The point field pointers
+    // are saved because the cell pre-migrate callback reuses the callback fields
+    //
+    callbackdata->Output->GetPoints()->SetNumberOfPoints(numFinal);
+    callbackdata->OutputPointsData = callbackdata->Output->GetPoints()->GetData()->GetVoidPointer(0);
+    vtkPointData *inPD  = vtkPointData::SafeDownCast(callbackdata->InputPointData);
+    vtkPointData *outPD = callbackdata->Output->GetPointData();
+    outPD->CopyAllOn();
+    outPD->CopyAllocate(inPD, numFinal);
+    this->InitializeFieldDataArrayPointers(callbackdata, inPD, outPD, numFinal);
+    this->PointInputArrayPointers  = callbackdata->InputArrayPointers;
+    this->PointOutputArrayPointers = callbackdata->OutputArrayPointers;
+    this->PointMemoryPerTuple      = callbackdata->MemoryPerTuple;
+    this->PointTotalSizePerId      = callbackdata->TotalSizePerId;
+    //
+    callbackdata->LocalToLocalIdMap.assign(numPts, -1);
+    callbackdata->OutPointCount = 0;
+    for (vtkIdType i=0; i<numPts; ++i) {
+        if (keepPoint[i]) {
+            outPD->CopyData(inPD, i, callbackdata->OutPointCount);
+            memcpy(
+              &((T*)(callbackdata->OutputPointsData))[callbackdata->OutPointCount*3],
+              &((T*)(callbackdata->InputPointsData))[i*3],
+              sizeof(T)*3);
+            callbackdata->LocalToLocalIdMap[i] = callbackdata->OutPointCount;
+            callbackdata->OutPointCount++;
+        }
+    }
+    this->ReceivedPointIds.clear();
+    this->PendingCells.clear();
+
+    //
+    // 4) send the cells
+    //
+    PartitionInfo cell_partitioninfo;
+    std::vector<int> cellParts(this->CellDestinations.begin(), this->CellDestinations.end());
+    for (vtkIdType cellId=0; cellId<numCells; ++cellId) {
+        if (cellParts[cellId]!=this->UpdatePiece) {
+            cell_partitioninfo.GlobalIds.push_back(cellId + cellOffset);
+            cell_partitioninfo.Procs.push_back(cellParts[cellId]);
+        }
+    }
+    vtkDebugMacro("Single phase migration : sending " << cell_partitioninfo.GlobalIds.size()
+        << " cells carrying " << carried << " points, receiving "
+        << numFinal-numKept << " points");
+
+    this->DroppedCells = 0;
+    this->PartitionCells(cell_partitioninfo, true);
+
+    if (callbackdata->OutPointCount!=numFinal) {
+        vtkErrorMacro("Serious Error : expected " << numFinal << " points, received " << callbackdata->OutPointCount);
+    }
+
+    //
+    // cells carry their points so none should be split, count the received
+    // cells dropped because a point did not arrive and the output cells using
+    // an invalid point. Points only used remotely moved, the other carried
+    // points are duplicates.
+    //
+    vtkIdType splitCells = this->DroppedCells;
+    std::vector<vtkCellArray*> outCells;
+    vtkPolyData         *pout = vtkPolyData::SafeDownCast(callbackdata->Output);
+    vtkUnstructuredGrid *uout = vtkUnstructuredGrid::SafeDownCast(callbackdata->Output);
+    if (pout) {
+        outCells.push_back(pout->GetVerts());
+        outCells.push_back(pout->GetLines());
+        outCells.push_back(pout->GetPolys());
+        outCells.push_back(pout->GetStrips());
+    }
+    else if (uout) {
+        outCells.push_back(uout->GetCells());
+    }
+    for (size_t c=0; c<outCells.size(); ++c) {
+        if (!outCells[c]) continue;
+        outCells[c]->InitTraversal();
+        while (outCells[c]->GetNextCell(npts, pts)) {
+            for (int j=0; j<npts; ++j) {
+                if (pts[j]<0 || pts[j]>=callbackdata->OutPointCount) {
+                    splitCells++;
+                    break;
+                }
+            }
+        }
+    }
+    this->ComputePartitionQuality(data, cellParts, splitCells, carried-(numPts-numKept));
+
+    if (this->InputDisposable) {
+        vtkDebugMacro("Disposing of input points and point data");
+        callbackdata->Input->SetPoints(NULL);
+        callbackdata->Input->GetPointData()->Initialize();
+    }
+
+    std::vector<vtkIdType>().swap(this->CellPointOffsets);
+    std::vector<unsigned char>().swap(this->CarryPoint);
+}
+
 //----------------------------------------------------------------------------
 void vtkMeshPartitionFilter::UnmarkInvalidGhostCells(vtkPointSet *outdata)
 {
@@ -30,6 +30,7 @@
 #include "vtkSmartPointer.h"
 //
 #include <vector>
+#include <unordered_map>
 //
 #include "zoltan.h"
 
@@ -62,7 +63,57 @@ class VTK_EXPORT vtkMeshPartitionFilter : public @VTK_ZOLTAN_PARTITION_FILTER@
     static void zoltan_unpack_obj_function_cell(void *data, int num_gid_entries,
       ZOLTAN_ID_PTR global_id, int size, char *buf, int *ierr);
 
-    int PartitionCells(PartitionInfo &cell_partitioninfo);
+    // Zoltan query functions used when cells are partitioned using the
+    // dual graph/hypergraph, data is the vtkMeshPartitionFilter
+    static int get_number_of_objects_cells(void *data, int *ierr);
+
+    static void get_object_list_cells(void *data, int sizeGID, int sizeLID,
+      ZOLTAN_ID_PTR globalID, ZOLTAN_ID_PTR localID, int wgt_dim, float *obj_wgts, int *ierr);
+
+    static void get_num_edges_list_cells(void *data, int sizeGID, int sizeLID, int num_obj,
+      ZOLTAN_ID_PTR globalID, ZOLTAN_ID_PTR localID, int *numEdges, int *ierr);
+
+    static void get_edge_list_cells(void *data, int sizeGID, int sizeLID, int num_obj,
+      ZOLTAN_ID_PTR globalID, ZOLTAN_ID_PTR localID, int *num_edges,
+      ZOLTAN_ID_PTR nborGID, int *nborProc, int wgt_dim, float *ewgts, int *ierr);
+
+    static void get_hypergraph_size_cells(void *data, int *num_lists, int *num_pins,
+      int *format, int *ierr);
+
+    static void get_hypergraph_cells(void *data, int sizeGID, int num_edges, int num_pins,
+      int format, ZOLTAN_ID_PTR edgeGID, int *vtxPtr, ZOLTAN_ID_PTR vtxGID, int *ierr);
+
+    // Zoltan callback : migration size in bytes of each cell, see CellBytes
+    static void get_object_sizes_cells(void *data, int num_gid_entries, int num_lid_entries,
+      int num_ids, ZOLTAN_ID_PTR global_ids, ZOLTAN_ID_PTR local_ids, int *sizes, int *ierr);
+
+    template<typename T>
+    static void get_geometry_list_cells(void *data, int sizeGID, int sizeLID, int num_obj,
+      ZOLTAN_ID_PTR globalID, ZOLTAN_ID_PTR localID, int num_dim, double *geom_vec, int *ierr);
+
+    // Zoltan migration callbacks used when cells carry the points they need
+    // (single phase migration), the first cell sent to a process with a given
+    // point carries the point coordinates and data
+    template <typename T>
+    static int zoltan_obj_size_function_cell_points(void *data, int num_gid_entries, int num_lid_entries,
+      ZOLTAN_ID_PTR global_id, ZOLTAN_ID_PTR local_id, int *ierr);
+
+    template <typename T>
+    static void zoltan_pack_obj_function_cell_points(void *data, int num_gid_entries, int num_lid_entries,
+      ZOLTAN_ID_PTR global_id, ZOLTAN_ID_PTR local_id, int dest, int size, char *buf, int *ierr);
+
+    template <typename T>
+    static void zoltan_unpack_obj_function_cell_points(void *data, int num_gid_entries,
+      ZOLTAN_ID_PTR global_id, int size, char *buf, int *ierr);
+
+    int PartitionCells(PartitionInfo &cell_partitioninfo, bool carryPoints=false);
+
+    // Description:
+    // Send each cell once to its destination together with the points it
+    // needs, replaces the point migration + cell migration of the two phase method.
+    // Only possible when cells have been partitioned and no ghost cells are needed.
+    template <typename T>
+    void MigrateCellsSinglePhase();
 
     template <typename T>
     void BuildCellToProcessList(
@@ -78,6 +129,13 @@ class VTK_EXPORT vtkMeshPartitionFilter : public @VTK_ZOLTAN_PARTITION_FILTER@
         Neighbour   = 3
     };
 
+    enum PartitionAlgorithm {
+        Points         = 0, // partition point coordinates, cells follow their points
+        CellGraph      = 1, // partition cells using the cell adjacency (dual) graph
+        CellHypergraph = 2, // partition cells using the cell/point hypergraph
+        CellCentroid   = 3, // partition cell centroids geometrically
+    };
+
     enum BoundaryAssignment {
         First    = 0, // cell assigned to process containing first point
         Most     = 1, // cell assigned to process containing most points
@@ -97,6 +155,44 @@ class VTK_EXPORT vtkMeshPartitionFilter : public @VTK_ZOLTAN_PARTITION_FILTER@
     void SetBoundaryModeToMost() { this->SetBoundaryMode(vtkMeshPartitionFilter::Most); }
     void SetBoundaryModeToCentroid() { this->SetBoundaryMode(vtkMeshPartitionFilter::Centroid); }
 
+    // PartitionMode selects the objects which are load balanced
+    // Points         = 0, point coordinates are partitioned geometrically, cells
+    //   are then assigned using BoundaryMode
+    // CellGraph      = 1, cells are partitioned using the graph of cells sharing
+    //   points (edge weight is the number of shared points) to minimize the edge cut
+    // CellHypergraph = 2, cells are partitioned using a hypergraph with one
+    //   hyperedge per point connecting all cells using it
+    // CellCentroid   = 3, cell centroids are partitioned using PartitionMethod
+    // The cell modes use Zoltan (PHG or geometric) whichever backend is selected.
+    // In the cell modes, when GhostMode is None and KeepInversePointLists is off,
+    // cells are migrated in a single exchange carrying the points they use.
+    vtkSetMacro(PartitionMode, int);
+    vtkGetMacro(PartitionMode, int);
+    // convenience setter/getters for PartitionMode
+    void SetPartitionModeToPoints() { this->SetPartitionMode(vtkMeshPartitionFilter::Points); }
+    void SetPartitionModeToCellGraph() { this->SetPartitionMode(vtkMeshPartitionFilter::CellGraph); }
+    void SetPartitionModeToCellHypergraph() { this->SetPartitionMode(vtkMeshPartitionFilter::CellHypergraph); }
+    void SetPartitionModeToCellCentroid() { this->SetPartitionMode(vtkMeshPartitionFilter::CellCentroid); }
+
+    // Description:
+    // Partition quality of the last execution, summed over all processes.
+    // NumberOfSharedPoints : points used by cells assigned to different
+    //   processes, the vertex separator of the partition (not the number of
+    //   cut edges of the dual graph, which Zoltan does not report). Points are
+    //   identified by their Id in each input piece, a point duplicated on
+    //   several input pieces is counted separately in each of them and a cut
+    //   between cells of different input pieces is not seen. It measures the
+    //   boundary within the input pieces, to compare partitions of the same input.
+    // NumberOfSplitCells : cells whose points were assigned to several processes,
+    //   when cells are partitioned the received cells missing one of their
+    //   points, which are dropped from the output (none unless the migration failed)
+    // NumberOfDuplicatedPoints : extra point copies sent or kept to complete cells
+    // NumberOfGhostCells : cells flagged as ghosts in the output
+    vtkGetMacro(NumberOfSharedPoints, vtkIdType);
+    vtkGetMacro(NumberOfSplitCells, vtkIdType);
+    vtkGetMacro(NumberOfDuplicatedPoints, vtkIdType);
+    vtkGetMacro(NumberOfGhostCells, vtkIdType);
+
     // GhostMode is an option to control how ghost cells are generated, modes are
     // Boundary: flags only cells which straddle the boundary of a partition
     //   the cell will be duplicated on all partitions that it overlaps, but on one
@@ -150,6 +246,25 @@ class VTK_EXPORT vtkMeshPartitionFilter : public @VTK_ZOLTAN_PARTITION_FILTER@
                             vtkInformationVector**,
                             vtkInformationVector*);
 
+    // when PartitionMode is not Points, cells are partitioned and points follow them
+    virtual void ExecuteZoltanPartition(vtkPointSet *output, vtkPointSet *input);
+    virtual void GetZoltanBoundingBoxes(vtkBoundingBox &globalBounds);
+    virtual vtkSmartPointer<vtkPKdTree> CreatePkdTree();
+
+    // build the point to cell links and (for CellGraph) the cell adjacency lists
+    void BuildCellGraph(vtkPointSet *data);
+
+    // partition cells with Zoltan (PHG or geometric), fills CellDestinations
+    void ComputeCellDestinations(vtkPointSet *data);
+
+    // bytes migrated with each cell : cell fields, connectivity and the
+    // share of each of its points (split between the cells using it)
+    void ComputeCellBytes(vtkPointSet *data);
+
+    // set NumberOfSharedPoints/NumberOfSplitCells/NumberOfDuplicatedPoints from the cell destinations
+    void ComputePartitionQuality(vtkPointSet *data, const std::vector<int> &cellParts,
+      vtkIdType splitCells, vtkIdType duplicatedPoints);
+
     // called after cell partition to ensure received cells are not marked as
     // ghost cells when they are only ghost cells on another process
     void UnmarkInvalidGhostCells(vtkPointSet *data);
@@ -158,6 +273,36 @@ class VTK_EXPORT vtkMeshPartitionFilter : public @VTK_ZOLTAN_PARTITION_FILTER@
     int                     BoundaryMode;
     int                     NumberOfGhostLevels;
     int                     KeepGhostRankArray;
+    int                     PartitionMode;
+    vtkIdType               NumberOfSharedPoints;
+    vtkIdType               NumberOfSplitCells;
+    vtkIdType               NumberOfDuplicatedPoints;
+    vtkIdType               NumberOfGhostCells;
+    //
+    // destination of each local cell when cells are partitioned (empty otherwise)
+    std::vector<int>        CellDestinations;
+    // point to cell links and cell adjacency (CSR)
+    std::vector<vtkIdType>  PointCellOffsets;
+    std::vector<vtkIdType>  PointCellIds;
+    std::vector<vtkIdType>  CellGraphOffsets;
+    std::vector<vtkIdType>  CellGraphAdjacency;
+    std::vector<float>      CellGraphWeights;
+    std::vector<int>        CellBytes;
+    //
+    // single phase migration : connectivity offsets of the local cells, flag
+    // for each cell point which is carried with the cell, point field pointers
+    // (the callback data field pointers hold the cell fields during migration)
+    // the received point Ids/cells waiting for all points to arrive and the
+    // number of received cells dropped because one of their points was missing
+    std::vector<vtkIdType>  CellPointOffsets;
+    std::vector<unsigned char> CarryPoint;
+    std::vector<void*>      PointInputArrayPointers;
+    std::vector<void*>      PointOutputArrayPointers;
+    std::vector<int>        PointMemoryPerTuple;
+    int                     PointTotalSizePerId;
+    std::unordered_map<vtkIdType, vtkIdType> ReceivedPointIds;
+    std::vector<vtkIdType>  PendingCells;
+    vtkIdType               DroppedCells;
     vtkSmartPointer<vtkIntArray>          ghost_cell_rank;
     vtkSmartPointer<vtkIntArray>          ghost_cell_out_rank;
     vtkSmartPointer<vtkUnsignedCharArray> ghost_cell_flags;
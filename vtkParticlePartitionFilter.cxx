@@ -18,6 +18,7 @@
 #include "vtkStreamingDemandDrivenPipeline.h"
 #include "vtkPolyData.h"
 #include "vtkUnstructuredGrid.h"
+#include "vtkMultiBlockDataSet.h"
 #include "vtkDataSetAttributes.h"
 #include "vtkPointData.h"
 #include "vtkCellData.h"
@@ -91,6 +92,7 @@ int vtkParticlePartitionFilter::RequestData(vtkInformation* info,
 
   if (this->UpdateNumPieces==1) {
     // input has been copied to output during PartitionPoints
+    this->ExtractPieces(vtkPointSet::GetData(outputVector, 0), vtkMultiBlockDataSet::GetData(outputVector, 1));
     return 1;
   }
 
@@ -209,24 +211,26 @@ int vtkParticlePartitionFilter::RequestData(vtkInformation* info,
   //
   // build a tree of bounding boxes to use for rendering info/hints or other spatial tests
   //
-#ifdef VTK_ZOLTAN1_PARTITION_FILTER
   vtkDebugMacro("Create KdTree");
   this->CreatePkdTree();
   this->ExtentTranslator->SetKdTree(this->GetKdtree());
-#endif
+  this->PieceExtentTranslator->SetKdTree(this->GetKdtree());
 
   //
   //*****************************************************************
   // Free the arrays allocated by Zoltan_LB_Partition, and free
-  // the storage allocated for the Zoltan structure.
+  // the storage allocated for the Zoltan structure
+  // (retained when partitioning incrementally).
   //*****************************************************************
   //
-  Zoltan_Destroy(&this->ZoltanData);
-  this->ZoltanData = NULL;
+  this->ReleaseZoltanData();
   this->MigrateLists.known.LocalIdsToKeep.clear();
 
   this->ZoltanCallbackData.Output->GetPointData()->AddArray(GhostArray);
 
+  // one block per local piece on the second output
+  this->ExtractPieces(this->ZoltanCallbackData.Output, vtkMultiBlockDataSet::GetData(outputVector, 1));
+
   this->Controller->Barrier();
   this->Timer->StopTimer();
   vtkDebugMacro("Particle partitioning : " << this->Timer->GetElapsedTime() << " seconds");
@@ -279,7 +283,7 @@ void vtkParticlePartitionFilter::FindPointsInHaloRegions(
     // Since we already have a list of points to export, we don't want to
     // duplicate them, so traverse the points list once per process
     // skipping those already flagged for export
-    vtkIdType N = pts->GetNumberOfPoints(), pE=0;
+    vtkIdType N = pts->GetNumberOfPoints();
     for (int proc=0; proc<this->UpdateNumPieces; proc++) {
         vtkBoundingBox &b = this->BoxListWithHalo[proc];
         int pc = 0;
@@ -291,8 +295,7 @@ void vtkParticlePartitionFilter::FindPointsInHaloRegions(
                 vtkIdType gID = i + this->ZoltanCallbackData.ProcessOffsetsPointId[this->ZoltanCallbackData.ProcessRank];
                 // if this ID is already marked as exported to the process then we don't need to send it again
                 // But, if it's marked for export and we need a local copy, we must add it to our keep list
-                if (/*pE<loadBalanceData.numExport && */loadBalanceData.exportGlobalGids[pE]==gID && loadBalanceData.exportProcs[pE]==proc) {
-                    pE++;
+                if (localId_to_process_map[i]==proc && proc!=this->UpdatePiece) {
                     continue;
                 }
                 double *pt = pts->GetPoint(i);
@@ -0,0 +1,776 @@
+/*=========================================================================
+
+  Module : vtkRCBPartitionFilter.cxx
+
+  Copyright (C) CSCS - Swiss National Supercomputing Centre.
+  You may use modify and and distribute this code freely providing
+  1) This copyright notice appears on all copies of source code
+  2) An acknowledgment appears with any substantial usage of the code
+  3) If this code is contributed to any other open source project, it
+  must not be reformatted such that the indentation, bracketing or
+  overall style is modified significantly.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even the
+  implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+=========================================================================*/
+//
+#include "vtkRCBPartitionFilter.h"
+#include "vtkPointSet.h"
+#include "vtkPoints.h"
+#include "vtkDataArray.h"
+#include "vtkObjectFactory.h"
+#include "vtkSmartPointer.h"
+#include "vtkBoundingBox.h"
+#include "vtkMultiProcessController.h"
+#include "vtkCommunicator.h"
+#include "vtkSMPTools.h"
+#include "vtkSMPThreadLocal.h"
+#include "vtkPKdTree.h"
+//
+#include "vtkBoundsExtentTranslator.h"
+//
+#include <cmath>
+#include <algorithm>
+#include <utility>
+#include <stack>
+
+//----------------------------------------------------------------------------
+#if defined ZOLTAN_DEBUG_OUTPUT && !defined VTK_WRAPPING_CXX
+
+# undef vtkDebugMacro
+# define vtkDebugMacro(msg)  \
+   DebugSynchronized(this->UpdatePiece, this->UpdateNumPieces, this->Controller, msg);
+
+# undef  vtkErrorMacro
+# define vtkErrorMacro(a) vtkDebugMacro(a)
+#endif
+//----------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkRCBPartitionFilter);
+//----------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------
+// Cut search windows of the boxes being bisected at the current level,
+// indexed by slot, Slot maps a tree node to its slot (-1 if not active)
+//----------------------------------------------------------------------------
+struct RCBActiveBoxes {
+  std::vector<int>    Slot;
+  std::vector<int>    Axis;
+  std::vector<double> Lo;
+  std::vector<double> Width;
+  std::vector<double> Cut;
+  int                 Size() const { return static_cast<int>(this->Axis.size()); }
+};
+
+//----------------------------------------------------------------------------
+// Weighted histogram of the coordinates in each active window. Every slot has
+// NumberOfBins+2 entries, the first/last hold the weight below/above the window.
+// Threads fill their own histograms which are summed in Reduce.
+// When Ids is set only the listed points are visited, PointNode[j] is then
+// the box of point Ids[j].
+//----------------------------------------------------------------------------
+template <typename T>
+struct RCBHistogramFunctor {
+  const T                             *Points;
+  const float                         *Weights;
+  const int                           *PointNode;
+  const RCBActiveBoxes                &Boxes;
+  int                                  NumberOfBins;
+  const vtkIdType                     *Ids;
+  std::vector<double>                  Histogram;
+  vtkSMPThreadLocal<std::vector<double> > LocalHistogram;
+
+  RCBHistogramFunctor(const T *pts, const float *weights, const int *pointnode,
+    const RCBActiveBoxes &boxes, int bins, const vtkIdType *ids=NULL)
+    : Points(pts), Weights(weights), PointNode(pointnode), Boxes(boxes), NumberOfBins(bins), Ids(ids) {}
+
+  void Initialize() {
+    this->LocalHistogram.Local().assign(this->Boxes.Size()*(this->NumberOfBins+2), 0.0);
+  }
+
+  void operator()(vtkIdType begin, vtkIdType end) {
+    std::vector<double> &histogram = this->LocalHistogram.Local();
+    const int B = this->NumberOfBins;
+    for (vtkIdType j=begin; j<end; ++j) {
+      int slot = this->Boxes.Slot[this->PointNode[j]];
+      if (slot<0) {
+        continue;
+      }
+      vtkIdType i = this->Ids ? this->Ids[j] : j;
+      double c  = this->Points[3*i + this->Boxes.Axis[slot]];
+      double lo = this->Boxes.Lo[slot];
+      double w  = this->Boxes.Width[slot];
+      int bin;
+      if (c<lo) {
+        bin = 0;
+      }
+      else if (c>=lo+w) {
+        bin = B+1;
+      }
+      else {
+        bin = 1 + std::min(B-1, static_cast<int>((c-lo)*B/w));
+      }
+      histogram[slot*(B+2) + bin] += this->Weights ? this->Weights[i] : 1.0;
+    }
+  }
+
+  void Reduce() {
+    this->Histogram.assign(this->Boxes.Size()*(this->NumberOfBins+2), 0.0);
+    typename vtkSMPThreadLocal<std::vector<double> >::iterator it;
+    for (it=this->LocalHistogram.begin(); it!=this->LocalHistogram.end(); ++it) {
+      for (size_t j=0; j<this->Histogram.size(); ++j) {
+        this->Histogram[j] += (*it)[j];
+      }
+    }
+  }
+};
+
+//----------------------------------------------------------------------------
+// Move each point of an active box into the lower or upper child box,
+// Ids as in RCBHistogramFunctor
+//----------------------------------------------------------------------------
+template <typename T>
+struct RCBSplitFunctor {
+  const T                                         *Points;
+  int                                             *PointNode;
+  const RCBActiveBoxes                            &Boxes;
+  const std::vector<vtkRCBPartitionFilter::RCBNode> &Nodes;
+  const vtkIdType                                 *Ids;
+
+  RCBSplitFunctor(const T *pts, int *pointnode, const RCBActiveBoxes &boxes,
+    const std::vector<vtkRCBPartitionFilter::RCBNode> &nodes, const vtkIdType *ids=NULL)
+    : Points(pts), PointNode(pointnode), Boxes(boxes), Nodes(nodes), Ids(ids) {}
+
+  void operator()(vtkIdType begin, vtkIdType end) {
+    for (vtkIdType j=begin; j<end; ++j) {
+      int node = this->PointNode[j];
+      int slot = this->Boxes.Slot[node];
+      if (slot<0) {
+        continue;
+      }
+      vtkIdType i = this->Ids ? this->Ids[j] : j;
+      const vtkRCBPartitionFilter::RCBNode &n = this->Nodes[node];
+      this->PointNode[j] = (this->Points[3*i + n.Axis]<n.Cut) ? n.Lower : n.Upper;
+    }
+  }
+};
+
+//----------------------------------------------------------------------------
+// Find the leaf box of each point by descending the tree, sets its part
+//----------------------------------------------------------------------------
+template <typename T>
+struct RCBLocateFunctor {
+  const T                                         *Points;
+  int                                             *Parts;
+  const std::vector<vtkRCBPartitionFilter::RCBNode> &Nodes;
+
+  RCBLocateFunctor(const T *pts, int *parts, const std::vector<vtkRCBPartitionFilter::RCBNode> &nodes)
+    : Points(pts), Parts(parts), Nodes(nodes) {}
+
+  void operator()(vtkIdType begin, vtkIdType end) {
+    for (vtkIdType i=begin; i<end; ++i) {
+      int node = 0;
+      while (this->Nodes[node].Lower>=0) {
+        const vtkRCBPartitionFilter::RCBNode &n = this->Nodes[node];
+        node = (this->Points[3*i + n.Axis]<n.Cut) ? n.Lower : n.Upper;
+      }
+      this->Parts[i] = this->Nodes[node].Part0;
+    }
+  }
+};
+
+//----------------------------------------------------------------------------
+// vtkRCBPartitionFilter :: implementation
+//----------------------------------------------------------------------------
+vtkRCBPartitionFilter::vtkRCBPartitionFilter()
+{
+  this->NumberOfBins        = 64;
+  this->NumberOfRefinements = 4;
+  this->DiffusiveRebalance  = 0;
+  this->RebalanceTolerance  = 0.05;
+  this->RebalanceBand       = 0.1;
+  this->NumberOfCutsMoved   = 0;
+  this->RefineCuts             = 0;
+  this->CutRefinementBand      = 0.05;
+  this->CutRefinementImbalance = 0.02;
+}
+//----------------------------------------------------------------------------
+vtkRCBPartitionFilter::~vtkRCBPartitionFilter()
+{
+}
+
+//----------------------------------------------------------------------------
+template <typename T>
+void vtkRCBPartitionFilter::ComputeRCB(
+  const T *pts, vtkIdType N, const float *weights, vtkBoundingBox &globalBounds)
+{
+  const int B = this->NumberOfBins;
+  const int P = this->NumberOfParts;
+  //
+  double localWeight = 0.0, totalWeight = 0.0;
+  for (vtkIdType i=0; i<N; ++i) {
+    localWeight += weights ? weights[i] : 1.0;
+  }
+  this->Controller->AllReduce(&localWeight, &totalWeight, 1, vtkCommunicator::SUM_OP);
+
+  //
+  // the root box holds all parts and all points
+  //
+  RCBNode root;
+  root.Part0  = 0;
+  root.Part1  = P;
+  globalBounds.GetBounds(root.Bounds);
+  root.Axis   = 0;
+  root.Cut    = 0.0;
+  root.Lower  = -1;
+  root.Upper  = -1;
+  root.Weight = totalWeight;
+  this->Nodes.assign(1, root);
+  this->PointNode.assign(N, 0);
+
+  std::vector<int> active(1, 0);
+  while (!active.empty()) {
+    //
+    // each box is cut across its longest axis, which keeps the aspect ratio
+    // of the boxes under control without any extra parameters
+    //
+    RCBActiveBoxes boxes;
+    boxes.Slot.assign(this->Nodes.size(), -1);
+    std::vector<double> target(active.size()), cumLo(active.size(), 0.0), cumHi(active.size(), 0.0);
+    for (size_t s=0; s<active.size(); ++s) {
+      RCBNode &n = this->Nodes[active[s]];
+      int axis = 0;
+      for (int j=1; j<3; ++j) {
+        if (n.Bounds[2*j+1]-n.Bounds[2*j] > n.Bounds[2*axis+1]-n.Bounds[2*axis]) {
+          axis = j;
+        }
+      }
+      int nlower = this->GetLowerPartCount(n.Part0, n.Part1);
+      boxes.Slot[active[s]] = static_cast<int>(s);
+      boxes.Axis.push_back(axis);
+      boxes.Lo.push_back(n.Bounds[2*axis]);
+      boxes.Width.push_back(n.Bounds[2*axis+1]-n.Bounds[2*axis]);
+      // share of the lower parts, which may differ from their count when
+      // the processes have different capacities
+      double size = this->GetPartSizeFraction(n.Part0, n.Part1);
+      target[s] = (size>0.0) ?
+        n.Weight*this->GetPartSizeFraction(n.Part0, n.Part0+nlower)/size :
+        n.Weight*nlower/(n.Part1-n.Part0);
+    }
+
+    //
+    // refine the cut windows, one reduction per refinement for the whole level
+    //
+    std::vector<double> histogram(active.size()*(B+2));
+    for (int r=0; r<this->NumberOfRefinements; ++r) {
+      RCBHistogramFunctor<T> functor(pts, weights, N>0 ? &this->PointNode[0] : NULL, boxes, B);
+      vtkSMPTools::For(0, N, functor);
+      if (functor.Histogram.empty()) {
+        functor.Histogram.assign(histogram.size(), 0.0);
+      }
+      this->Controller->AllReduce(&functor.Histogram[0], &histogram[0],
+        static_cast<vtkIdType>(histogram.size()), vtkCommunicator::SUM_OP);
+      //
+      for (size_t s=0; s<active.size(); ++s) {
+        const double *h = &histogram[s*(B+2)];
+        double cumulative = h[0];
+        int k = B-1;
+        for (int b=0; b<B; ++b) {
+          if (cumulative+h[b+1]>=target[s]) {
+            k = b;
+            break;
+          }
+          cumulative += h[b+1];
+        }
+        cumLo[s] = cumulative;
+        cumHi[s] = cumulative + h[k+1];
+        boxes.Width[s] /= B;
+        boxes.Lo[s]    += k*boxes.Width[s];
+      }
+    }
+
+    //
+    // place the cut on the nearer edge of the final window, then optionally
+    // move it to a sparser position nearby
+    //
+    std::vector<double> cuts(active.size()), lowerWeights(active.size());
+    for (size_t s=0; s<active.size(); ++s) {
+      bool useLo = (target[s]-cumLo[s] <= cumHi[s]-target[s]);
+      cuts[s]         = useLo ? boxes.Lo[s] : boxes.Lo[s]+boxes.Width[s];
+      lowerWeights[s] = useLo ? cumLo[s] : cumHi[s];
+    }
+    if (this->RefineCuts) {
+      this->RefineCutPositions(pts, N, weights, boxes, target, cuts, lowerWeights);
+    }
+
+    //
+    // create children
+    //
+    std::vector<int> next;
+    for (size_t s=0; s<active.size(); ++s) {
+      int node = active[s];
+      double cut = cuts[s];
+      double lowerWeight = lowerWeights[s];
+      //
+      RCBNode lower = this->Nodes[node], upper = this->Nodes[node];
+      int nlower = this->GetLowerPartCount(lower.Part0, lower.Part1);
+      lower.Part1  = lower.Part0 + nlower;
+      upper.Part0  = lower.Part1;
+      lower.Bounds[2*boxes.Axis[s]+1] = cut;
+      upper.Bounds[2*boxes.Axis[s]]   = cut;
+      lower.Weight = lowerWeight;
+      upper.Weight = this->Nodes[node].Weight - lowerWeight;
+      //
+      this->Nodes[node].Axis  = boxes.Axis[s];
+      this->Nodes[node].Cut   = cut;
+      this->Nodes[node].Lower = static_cast<int>(this->Nodes.size());
+      this->Nodes.push_back(lower);
+      this->Nodes[node].Upper = static_cast<int>(this->Nodes.size());
+      this->Nodes.push_back(upper);
+      //
+      if (lower.Part1-lower.Part0>1) next.push_back(this->Nodes[node].Lower);
+      if (upper.Part1-upper.Part0>1) next.push_back(this->Nodes[node].Upper);
+    }
+    boxes.Slot.resize(this->Nodes.size(), -1);
+
+    RCBSplitFunctor<T> split(pts, N>0 ? &this->PointNode[0] : NULL, boxes, this->Nodes);
+    vtkSMPTools::For(0, N, split);
+    active.swap(next);
+  }
+}
+
+//----------------------------------------------------------------------------
+template <typename T>
+void vtkRCBPartitionFilter::RefineCutPositions(
+  const T *pts, vtkIdType N, const float *weights, const RCBActiveBoxes &boxes,
+  const std::vector<double> &target, std::vector<double> &cuts, std::vector<double> &lowerWeights)
+{
+  const int B = this->NumberOfBins;
+  const int S = boxes.Size();
+  //
+  // window of CutRefinementBand around each cut, widened by the halo so that
+  // the points near the candidates at its ends are counted too
+  //
+  RCBActiveBoxes window = boxes;
+  std::vector<double> halo(S), band(S);
+  for (size_t node=0; node<boxes.Slot.size(); ++node) {
+    int s = boxes.Slot[node];
+    if (s<0) {
+      continue;
+    }
+    const RCBNode &n = this->Nodes[node];
+    double width = n.Bounds[2*boxes.Axis[s]+1] - n.Bounds[2*boxes.Axis[s]];
+    band[s] = this->CutRefinementBand*width;
+    // the halo is at least one bin of the window, mesh filters often have no
+    // halo size : halo >= 2*(band+halo)/B when NumberOfBins>2
+    halo[s] = std::max(this->GhostHaloSize, 2.0*band[s]/std::max(B-2, 1));
+    window.Lo[s]    = cuts[s] - band[s] - halo[s];
+    window.Width[s] = 2.0*(band[s] + halo[s]);
+  }
+
+  //
+  // weight and number of points in every bin, one reduction for all cuts
+  //
+  RCBHistogramFunctor<T> weighted(pts, weights, N>0 ? &this->PointNode[0] : NULL, window, B);
+  RCBHistogramFunctor<T> counted(pts, NULL, N>0 ? &this->PointNode[0] : NULL, window, B);
+  vtkSMPTools::For(0, N, weighted);
+  vtkSMPTools::For(0, N, counted);
+  size_t H = static_cast<size_t>(S)*(B+2);
+  std::vector<double> local(2*H, 0.0), histogram(2*H, 0.0);
+  if (!weighted.Histogram.empty()) {
+    std::copy(weighted.Histogram.begin(), weighted.Histogram.end(), local.begin());
+    std::copy(counted.Histogram.begin(), counted.Histogram.end(), local.begin()+H);
+  }
+  this->Controller->AllReduce(&local[0], &histogram[0], static_cast<vtkIdType>(2*H), vtkCommunicator::SUM_OP);
+
+  //
+  // candidates are the bin edges inside the band, keep the one with the fewest
+  // points within the halo of the plane whose lower weight stays within
+  // CutRefinementImbalance of the target, ties go to the nearest to the cut
+  //
+  for (int s=0; s<S; ++s) {
+    const double *w = &histogram[s*(B+2)];
+    const double *c = &histogram[H + s*(B+2)];
+    double bw = window.Width[s]/B;
+    int k = std::max(1, static_cast<int>(halo[s]/bw + 0.5));
+    double bestCount = VTK_DOUBLE_MAX, bestDistance = VTK_DOUBLE_MAX;
+    double median = cuts[s], below = w[0];
+    for (int e=0; e<=B; ++e) {
+      double position = window.Lo[s] + e*bw;
+      if (e>0) {
+        below += w[e];
+      }
+      if (std::fabs(position-median)>band[s]+0.5*bw ||
+          std::fabs(below-target[s])>this->CutRefinementImbalance*target[s]) {
+        continue;
+      }
+      double count = 0.0;
+      for (int b=std::max(0, e-k); b<std::min(B, e+k); ++b) {
+        count += c[b+1];
+      }
+      double distance = std::fabs(position-median);
+      if (count<bestCount || (count==bestCount && distance<bestDistance)) {
+        bestCount    = count;
+        bestDistance = distance;
+        cuts[s]         = position;
+        lowerWeights[s] = below;
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+template <typename T>
+bool vtkRCBPartitionFilter::RebalanceRCB(
+  const T *pts, vtkIdType N, const float *weights,
+  vtkBoundingBox &globalBounds, std::vector<int> &parts)
+{
+  const int B = this->NumberOfBins;
+  const int P = this->NumberOfParts;
+  if (this->Nodes.empty() || this->Nodes[0].Part1!=P || this->TreePartSizes!=this->PartSizes) {
+    return false;
+  }
+
+  //
+  // part of every point in the previous tree, the load of all parts with one
+  // reduction gives the weight of every node (children follow their parent)
+  //
+  parts.resize(N);
+  RCBLocateFunctor<T> locate(pts, N>0 ? &parts[0] : NULL, this->Nodes);
+  vtkSMPTools::For(0, N, locate);
+  std::vector<double> localLoad(P, 0.0), load(P, 0.0);
+  for (vtkIdType i=0; i<N; ++i) {
+    localLoad[parts[i]] += weights ? weights[i] : 1.0;
+  }
+  this->Controller->AllReduce(&localLoad[0], &load[0], P, vtkCommunicator::SUM_OP);
+  for (int n=static_cast<int>(this->Nodes.size())-1; n>=0; --n) {
+    RCBNode &node = this->Nodes[n];
+    node.Weight = (node.Lower<0) ? load[node.Part0] :
+      this->Nodes[node.Lower].Weight + this->Nodes[node.Upper].Weight;
+  }
+  globalBounds.GetBounds(this->Nodes[0].Bounds);
+
+  //
+  // points sorted by part, the points of a node are those of its part range
+  //
+  std::vector<vtkIdType> partStart(P+1, 0), order(N);
+  for (vtkIdType i=0; i<N; ++i) {
+    partStart[parts[i]+1]++;
+  }
+  for (int p=0; p<P; ++p) {
+    partStart[p+1] += partStart[p];
+  }
+  std::vector<vtkIdType> position(partStart.begin(), partStart.end()-1);
+  for (vtkIdType i=0; i<N; ++i) {
+    order[position[parts[i]]++] = i;
+  }
+
+  //
+  // descend level by level, a node is refined if its box has changed (a cut
+  // above it moved) or its cut is out of balance, the others keep their cut.
+  // Only the points of refined nodes are visited : the first refined node of
+  // a branch adds its points to the moving list, PointNode[j] is the box of
+  // point moving[j], the other points keep the part located above.
+  //
+  std::vector<char> changed(this->Nodes.size(), 0), tracked(this->Nodes.size(), 0);
+  std::vector<int> active(this->Nodes[0].Lower>=0 ? 1 : 0, 0);
+  std::vector<vtkIdType> moving;
+  this->PointNode.clear();
+  while (!active.empty()) {
+    RCBActiveBoxes boxes, level;
+    boxes.Slot.assign(this->Nodes.size(), -1);
+    level.Slot.assign(this->Nodes.size(), -1);
+    std::vector<int> refined;
+    std::vector<double> target;
+    for (size_t a=0; a<active.size(); ++a) {
+      RCBNode &n = this->Nodes[active[a]];
+      level.Slot[active[a]] = static_cast<int>(a);
+      int nlower = this->GetLowerPartCount(n.Part0, n.Part1);
+      double size = this->GetPartSizeFraction(n.Part0, n.Part1);
+      double t = (size>0.0) ?
+        n.Weight*this->GetPartSizeFraction(n.Part0, n.Part0+nlower)/size :
+        n.Weight*nlower/(n.Part1-n.Part0);
+      double lowerWeight = this->Nodes[n.Lower].Weight;
+      if (!changed[active[a]] && std::fabs(lowerWeight-t)<=this->RebalanceTolerance*std::max(t, n.Weight-t)) {
+        continue;
+      }
+      if (!tracked[active[a]]) {
+        tracked[active[a]] = 1;
+        moving.insert(moving.end(), order.begin()+partStart[n.Part0], order.begin()+partStart[n.Part1]);
+        this->PointNode.resize(moving.size(), active[a]);
+      }
+      //
+      // search window of RebalanceBand around the old cut, inside the box
+      //
+      double lo = n.Bounds[2*n.Axis], hi = n.Bounds[2*n.Axis+1];
+      double band = this->RebalanceBand*(hi-lo);
+      double wlo = std::max(lo, n.Cut-0.5*band), whi = std::min(hi, n.Cut+0.5*band);
+      if (whi<=wlo) {
+        wlo = lo;
+        whi = hi;
+      }
+      boxes.Slot[active[a]] = static_cast<int>(refined.size());
+      boxes.Axis.push_back(n.Axis);
+      boxes.Lo.push_back(wlo);
+      boxes.Width.push_back(whi-wlo);
+      refined.push_back(active[a]);
+      target.push_back(t);
+    }
+    vtkIdType M = static_cast<vtkIdType>(moving.size());
+    const vtkIdType *ids = M>0 ? &moving[0] : NULL;
+    int *pointnode = M>0 ? &this->PointNode[0] : NULL;
+
+    //
+    // refine the windows of the nodes which move, as in ComputeRCB
+    //
+    std::vector<double> histogram(refined.size()*(B+2));
+    std::vector<double> cumLo(refined.size(), 0.0), cumHi(refined.size(), 0.0);
+    for (int r=0; r<this->NumberOfRefinements && !refined.empty(); ++r) {
+      RCBHistogramFunctor<T> functor(pts, weights, pointnode, boxes, B, ids);
+      vtkSMPTools::For(0, M, functor);
+      if (functor.Histogram.empty()) {
+        functor.Histogram.assign(histogram.size(), 0.0);
+      }
+      this->Controller->AllReduce(&functor.Histogram[0], &histogram[0],
+        static_cast<vtkIdType>(histogram.size()), vtkCommunicator::SUM_OP);
+      //
+      for (size_t s=0; s<refined.size(); ++s) {
+        const double *h = &histogram[s*(B+2)];
+        double cumulative = h[0];
+        int k = B-1;
+        for (int b=0; b<B; ++b) {
+          if (cumulative+h[b+1]>=target[s]) {
+            k = b;
+            break;
+          }
+          cumulative += h[b+1];
+        }
+        cumLo[s] = cumulative;
+        cumHi[s] = cumulative + h[k+1];
+        boxes.Width[s] /= B;
+        boxes.Lo[s]    += k*boxes.Width[s];
+      }
+    }
+    for (size_t s=0; s<refined.size(); ++s) {
+      RCBNode &n = this->Nodes[refined[s]];
+      bool useLo = (target[s]-cumLo[s] <= cumHi[s]-target[s]);
+      double cut = useLo ? boxes.Lo[s] : boxes.Lo[s]+boxes.Width[s];
+      double lowerWeight = useLo ? cumLo[s] : cumHi[s];
+      //
+      // the balance point is outside the band, the histograms are global so
+      // every rank gives up here and the tree is rebuilt
+      //
+      if (std::fabs(lowerWeight-target[s])>this->RebalanceTolerance*std::max(target[s], n.Weight-target[s])) {
+        vtkDebugMacro("RCB rebalance cannot balance node " << refined[s] << " within its band");
+        this->PointNode.clear();
+        return false;
+      }
+      // cuts are only located to within the final window
+      if (std::fabs(cut-n.Cut)>boxes.Width[s]) {
+        this->NumberOfCutsMoved++;
+        changed[n.Lower] = changed[n.Upper] = 1;
+      }
+      n.Cut = cut;
+      this->Nodes[n.Lower].Weight = lowerWeight;
+      this->Nodes[n.Upper].Weight = n.Weight - lowerWeight;
+    }
+
+    //
+    // children take the (possibly new) box of their parent split at the cut
+    //
+    std::vector<int> next;
+    for (size_t a=0; a<active.size(); ++a) {
+      const RCBNode &n = this->Nodes[active[a]];
+      RCBNode &lower = this->Nodes[n.Lower], &upper = this->Nodes[n.Upper];
+      std::copy(n.Bounds, n.Bounds+6, lower.Bounds);
+      std::copy(n.Bounds, n.Bounds+6, upper.Bounds);
+      lower.Bounds[2*n.Axis+1] = std::max(n.Bounds[2*n.Axis], std::min(n.Cut, n.Bounds[2*n.Axis+1]));
+      upper.Bounds[2*n.Axis]   = lower.Bounds[2*n.Axis+1];
+      if (changed[active[a]]) {
+        changed[n.Lower] = changed[n.Upper] = 1;
+      }
+      if (tracked[active[a]]) {
+        tracked[n.Lower] = tracked[n.Upper] = 1;
+      }
+      if (lower.Part1-lower.Part0>1) next.push_back(n.Lower);
+      if (upper.Part1-upper.Part0>1) next.push_back(n.Upper);
+    }
+    RCBSplitFunctor<T> split(pts, pointnode, level, this->Nodes, ids);
+    vtkSMPTools::For(0, M, split);
+    active.swap(next);
+  }
+
+  for (size_t j=0; j<moving.size(); ++j) {
+    parts[moving[j]] = this->Nodes[this->PointNode[j]].Part0;
+  }
+  this->PointNode.clear();
+  vtkDebugMacro("RCB rebalance moved " << this->NumberOfCutsMoved << " cuts, visited " << moving.size() << " of " << N << " points");
+  return true;
+}
+
+//----------------------------------------------------------------------------
+template <typename T>
+void vtkRCBPartitionFilter::ComputeParts(
+  const T *pts, vtkIdType N, const float *weights,
+  vtkBoundingBox &globalBounds, bool sampling, std::vector<int> &parts)
+{
+  this->NumberOfCutsMoved = 0;
+  if (!sampling && this->DiffusiveRebalance &&
+      this->RebalanceRCB(pts, N, weights, globalBounds, parts)) {
+    return;
+  }
+  this->NumberOfCutsMoved = 0;
+  this->TreePartSizes = this->PartSizes;
+  parts.resize(N);
+  if (!sampling) {
+    this->ComputeRCB(pts, N, weights, globalBounds);
+    for (vtkIdType i=0; i<N; ++i) {
+      parts[i] = this->Nodes[this->PointNode[i]].Part0;
+    }
+    return;
+  }
+  //
+  // bisect a copy of the sample points, the root box is still the global bounds
+  //
+  const std::vector<vtkIdType> &samples = this->ZoltanCallbackData.SampleIds;
+  vtkIdType S = static_cast<vtkIdType>(samples.size());
+  std::vector<T>     samplePts(3*S);
+  std::vector<float> sampleWeights(weights ? S : 0);
+  for (vtkIdType j=0; j<S; ++j) {
+    std::copy(&pts[3*samples[j]], &pts[3*samples[j]+3], &samplePts[3*j]);
+    if (weights) {
+      sampleWeights[j] = weights[samples[j]];
+    }
+  }
+  this->ComputeRCB(S>0 ? &samplePts[0] : static_cast<const T*>(NULL), S,
+    (weights && S>0) ? &sampleWeights[0] : static_cast<const float*>(NULL), globalBounds);
+  //
+  std::vector<int> sampleParts(S);
+  for (vtkIdType j=0; j<S; ++j) {
+    sampleParts[j] = this->Nodes[this->PointNode[j]].Part0;
+  }
+  this->ComputeSampleImbalance(sampleParts);
+  this->ZoltanCallbackData.SampleIds.clear();
+  this->PointNode.clear();
+  //
+  RCBLocateFunctor<T> locate(pts, N>0 ? &parts[0] : NULL, this->Nodes);
+  vtkSMPTools::For(0, N, locate);
+}
+
+//----------------------------------------------------------------------------
+void vtkRCBPartitionFilter::ExecuteZoltanPartition(
+    vtkPointSet *output,
+    vtkPointSet *input)
+{
+  vtkIdType N = input->GetNumberOfPoints();
+  vtkBoundingBox globalBounds = this->GetGlobalBounds(input);
+
+  //
+  // bisect using the input points as they are, no copy is made unless sampling
+  //
+  bool sampling = this->SelectSamplePoints(N);
+  const float *weights = (N>0) ? this->GetCriterionWeights(0) : NULL;
+  std::vector<int> parts;
+  if (this->ZoltanCallbackData.PointType==VTK_FLOAT) {
+    this->ComputeParts(static_cast<float*>(this->ZoltanCallbackData.InputPointsData), N, weights, globalBounds, sampling, parts);
+  }
+  else if (this->ZoltanCallbackData.PointType==VTK_DOUBLE) {
+    this->ComputeParts(static_cast<double*>(this->ZoltanCallbackData.InputPointsData), N, weights, globalBounds, sampling, parts);
+  }
+  this->SetExportListsFromParts(parts);
+
+  // weight of each leaf relative to the target of its part
+  double imbalance = 0.0, totalWeight = this->Nodes[0].Weight;
+  for (size_t n=0; n<this->Nodes.size() && totalWeight>0.0; ++n) {
+    const RCBNode &node = this->Nodes[n];
+    if (node.Part1-node.Part0==1) {
+      double share = this->GetPartSizeFraction(node.Part0, node.Part1);
+      imbalance = std::max(imbalance, node.Weight/(totalWeight*(share>0.0 ? share : 1.0/this->NumberOfParts)));
+    }
+  }
+  this->ImbalanceValue = totalWeight>0.0 ? static_cast<float>(imbalance) : 1.0f;
+  vtkDebugMacro("RCB partition complete, imbalance " << this->ImbalanceValue);
+}
+
+//----------------------------------------------------------------------------
+void vtkRCBPartitionFilter::GetZoltanBoundingBoxes(vtkBoundingBox &globalBounds)
+{
+  //
+  // every rank holds the same tree, the leaf boxes are the partition boxes
+  //
+  this->BoxList.assign(this->NumberOfParts, vtkBoundingBox());
+  for (size_t n=0; n<this->Nodes.size(); ++n) {
+    const RCBNode &node = this->Nodes[n];
+    if (node.Part1-node.Part0==1) {
+      this->BoxList[node.Part0].SetBounds(node.Bounds);
+    }
+  }
+  for (int p=0; p<this->NumberOfParts; p++) {
+    double bounds[6];
+    this->BoxList[p].GetBounds(bounds);
+    this->ExtentTranslator->SetBoundsForPiece(p, bounds);
+  }
+  this->ExtentTranslator->InitWholeBounds();
+}
+
+//----------------------------------------------------------------------------
+vtkSmartPointer<vtkPKdTree> vtkRCBPartitionFilter::CreatePkdTree()
+{
+  if (this->Nodes.empty() || this->PartitionSkipped) {
+    this->KdTree = NULL;
+    return NULL;
+  }
+
+  // list we will pass to CreateCuts
+  std::vector<int>    cut_axis;
+  std::vector<double> cut_position;
+  std::vector<int>    cut_lower;
+  std::vector<int>    cut_upper;
+
+  //
+  // depth first traversal, lower child before upper, using the same
+  // parent patching as the Zoltan RCB tree conversion
+  //
+  typedef std::pair<int, int> cutpair;
+  std::stack<cutpair> tree_stack;
+  tree_stack.push(cutpair(0,-1));
+  while (!tree_stack.empty()) {
+    const RCBNode &node = this->Nodes[tree_stack.top().first];
+    int node_parent = tree_stack.top().second;
+    tree_stack.pop();
+
+    int new_node_index = static_cast<int>(cut_position.size());
+    if (node.Part1-node.Part0==1) {
+      // leaf, set the (region) Id for BSPCuts to use
+      cut_position.push_back(0.0);
+      cut_axis.push_back(0);
+      cut_lower.push_back(-node.Part0);
+      cut_upper.push_back(-1);
+    }
+    else {
+      cut_position.push_back(node.Cut);
+      cut_axis.push_back(node.Axis);
+      cut_lower.push_back(-1);
+      cut_upper.push_back(-1);
+      tree_stack.push(cutpair(node.Upper, new_node_index));
+      tree_stack.push(cutpair(node.Lower, new_node_index));
+    }
+    if (node_parent>=0) {
+      if (cut_lower[node_parent] == -1) {
+        cut_lower[node_parent] = new_node_index;
+      }
+      else {
+        cut_upper[node_parent] = new_node_index;
+      }
+    }
+  }
+
+  // parts are not renumbered, region i is part i
+  std::vector<int> remapping(this->NumberOfParts);
+  for (int i=0; i<this->NumberOfParts; i++) {
+    remapping[i] = i;
+  }
+  return this->CreatePkdTreeFromCuts(cut_axis, cut_position, cut_lower, cut_upper, &remapping[0]);
+}
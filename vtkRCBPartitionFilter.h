@@ -0,0 +1,162 @@
+/*=========================================================================
+
+  Module : vtkRCBPartitionFilter.h
+
+  Copyright (C) CSCS - Swiss National Supercomputing Centre.
+  You may use modify and and distribute this code freely providing
+  1) This copyright notice appears on all copies of source code
+  2) An acknowledgment appears with any substantial usage of the code
+  3) If this code is contributed to any other open source project, it
+  must not be reformatted such that the indentation, bracketing or
+  overall style is modified significantly.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even the
+  implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+=========================================================================*/
+//
+// .NAME vtkRCBPartitionFilter Native recursive coordinate bisection
+// .SECTION Description
+// vtkRCBPartitionFilter computes an RCB partition without Zoltan. The points
+// are read directly from the input vtkPoints in their native float/double
+// type (no copy is made), and the weighted median of every box is found
+// with histograms built by all threads of the rank (vtkSMPTools).
+// All boxes of one level of the tree are bisected together, so each
+// refinement of the cuts needs a single reduction whatever the number of
+// boxes. The tree of cuts is kept so that a vtkPKdTree2 can be built from it.
+//
+// .SECTION See Also
+// vtkZoltanV1PartitionFilter, vtkSFCPartitionFilter
+//
+#ifndef __vtkRCBPartitionFilter_h
+#define __vtkRCBPartitionFilter_h
+//
+#include "vtkZoltanBasePartitionFilter.h"
+
+struct RCBActiveBoxes;
+
+//----------------------------------------------------------------------------
+class VTK_EXPORT vtkRCBPartitionFilter : public vtkZoltanBasePartitionFilter
+{
+  public:
+    static vtkRCBPartitionFilter *New();
+    vtkTypeMacro(vtkRCBPartitionFilter, vtkZoltanBasePartitionFilter);
+
+    // Description:
+    // Number of histogram bins used when searching for each cut
+    vtkSetClampMacro(NumberOfBins, int, 2, 4096);
+    vtkGetMacro(NumberOfBins, int);
+
+    // Description:
+    // Number of histogram refinements per cut, the cut is located to within
+    // (box width)/(NumberOfBins^NumberOfRefinements)
+    vtkSetClampMacro(NumberOfRefinements, int, 1, 16);
+    vtkGetMacro(NumberOfRefinements, int);
+
+    // Description:
+    // When the load has drifted only a little since the last execution, keep
+    // the previous tree and move its cuts instead of bisecting again. The load
+    // of every part is measured with one reduction, cuts whose two sides are
+    // within RebalanceTolerance of their targets are kept, the others are
+    // moved by at most RebalanceBand (fraction of the box width) so that only
+    // points near the moved planes change part. After locating the points in
+    // the old tree, only the points of the boxes being moved are visited. The
+    // tree is rebuilt when a cut cannot be balanced inside its band, when the
+    // number of parts or their sizes change, or when sampling.
+    vtkSetMacro(DiffusiveRebalance, int);
+    vtkGetMacro(DiffusiveRebalance, int);
+    vtkBooleanMacro(DiffusiveRebalance, int);
+    vtkSetClampMacro(RebalanceTolerance, double, 0.0, 1.0);
+    vtkGetMacro(RebalanceTolerance, double);
+    vtkSetClampMacro(RebalanceBand, double, 0.0, 1.0);
+    vtkGetMacro(RebalanceBand, double);
+
+    // Description:
+    // Ghost aware cuts : after its weighted median is found, each cut is moved
+    // within CutRefinementBand (fraction of the box width) to the position
+    // with the fewest points within GhostHaloSize of the plane (one histogram
+    // bin when there is no halo), as long as the weight below it stays within
+    // CutRefinementImbalance of its target. Cuts through sparse regions split
+    // fewer cells and give smaller halos. One extra reduction per level.
+    vtkSetMacro(RefineCuts, int);
+    vtkGetMacro(RefineCuts, int);
+    vtkBooleanMacro(RefineCuts, int);
+    vtkSetClampMacro(CutRefinementBand, double, 0.0, 0.5);
+    vtkGetMacro(CutRefinementBand, double);
+    vtkSetClampMacro(CutRefinementImbalance, double, 0.0, 1.0);
+    vtkGetMacro(CutRefinementImbalance, double);
+
+    // Description:
+    // Number of cuts moved by more than their resolution in the last rebalance
+    // (0 when the tree was rebuilt)
+    // only valid after the filter has executed
+    vtkGetMacro(NumberOfCutsMoved, int);
+
+    //BTX
+    // one box of the bisection tree, parts [Part0,Part1) are inside it
+    struct RCBNode {
+      int    Part0, Part1;
+      double Bounds[6];
+      int    Axis;
+      double Cut;
+      int    Lower, Upper;
+      double Weight;
+    };
+    //ETX
+
+  protected:
+     vtkRCBPartitionFilter();
+    ~vtkRCBPartitionFilter();
+
+    virtual void ExecuteZoltanPartition(vtkPointSet *output, vtkPointSet *input);
+    virtual void GetZoltanBoundingBoxes(vtkBoundingBox &globalBounds);
+    virtual vtkSmartPointer<vtkPKdTree> CreatePkdTree();
+
+    // Description:
+    // Bisect all boxes level by level, PointNode holds the box of each point
+    template <typename T>
+    void ComputeRCB(const T *pts, vtkIdType N, const float *weights, vtkBoundingBox &globalBounds);
+
+    // Description:
+    // Move the cut of every active box to the sparsest position of its band
+    // which keeps the weight below within CutRefinementImbalance of target
+    template <typename T>
+    void RefineCutPositions(const T *pts, vtkIdType N, const float *weights,
+      const RCBActiveBoxes &boxes, const std::vector<double> &target,
+      std::vector<double> &cuts, std::vector<double> &lowerWeights);
+
+    // Description:
+    // Move the cuts of the previous tree to restore the balance, sets the
+    // part of every point. Returns false if the tree cannot be reused or
+    // cannot be balanced within RebalanceBand.
+    template <typename T>
+    bool RebalanceRCB(const T *pts, vtkIdType N, const float *weights,
+      vtkBoundingBox &globalBounds, std::vector<int> &parts);
+
+    // Description:
+    // Bisect the points (or the sample points when sampling) and set the part
+    // of every point, sampled partitions locate each point in the tree
+    template <typename T>
+    void ComputeParts(const T *pts, vtkIdType N, const float *weights,
+      vtkBoundingBox &globalBounds, bool sampling, std::vector<int> &parts);
+
+    int                  NumberOfBins;
+    int                  NumberOfRefinements;
+    int                  DiffusiveRebalance;
+    double               RebalanceTolerance;
+    double               RebalanceBand;
+    int                  NumberOfCutsMoved;
+    int                  RefineCuts;
+    double               CutRefinementBand;
+    double               CutRefinementImbalance;
+    //
+    std::vector<RCBNode> Nodes;
+    std::vector<int>     PointNode;
+    std::vector<double>  TreePartSizes;
+
+  private:
+    vtkRCBPartitionFilter(const vtkRCBPartitionFilter&);  // Not implemented.
+    void operator=(const vtkRCBPartitionFilter&);  // Not implemented.
+};
+
+#endif
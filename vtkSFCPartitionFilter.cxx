@@ -0,0 +1,334 @@
+/*=========================================================================
+
+  Module : vtkSFCPartitionFilter.cxx
+
+  Copyright (C) CSCS - Swiss National Supercomputing Centre.
+  You may use modify and and distribute this code freely providing
+  1) This copyright notice appears on all copies of source code
+  2) An acknowledgment appears with any substantial usage of the code
+  3) If this code is contributed to any other open source project, it
+  must not be reformatted such that the indentation, bracketing or
+  overall style is modified significantly.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even the
+  implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+=========================================================================*/
+//
+#include "vtkSFCPartitionFilter.h"
+#include "vtkPointSet.h"
+#include "vtkPoints.h"
+#include "vtkDataArray.h"
+#include "vtkObjectFactory.h"
+#include "vtkSmartPointer.h"
+#include "vtkBoundingBox.h"
+#include "vtkPKdTree.h"
+#include "vtkMultiProcessController.h"
+#include "vtkCommunicator.h"
+//
+// For PARAVIEW_USE_MPI
+#include "vtkPVConfig.h"
+#ifdef PARAVIEW_USE_MPI
+  #include "vtkMPI.h"
+  #include "vtkMPIController.h"
+  #include "vtkMPICommunicator.h"
+#endif
+//
+#include "vtkBoundsExtentTranslator.h"
+//
+#include <cmath>
+#include <numeric>
+#include <algorithm>
+#include <utility>
+
+//----------------------------------------------------------------------------
+#if defined ZOLTAN_DEBUG_OUTPUT && !defined VTK_WRAPPING_CXX
+
+# undef vtkDebugMacro
+# define vtkDebugMacro(msg)  \
+   DebugSynchronized(this->UpdatePiece, this->UpdateNumPieces, this->Controller, msg);
+
+# undef  vtkErrorMacro
+# define vtkErrorMacro(a) vtkDebugMacro(a)
+#endif
+//----------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkSFCPartitionFilter);
+//----------------------------------------------------------------------------
+
+// 21 bits per axis gives a 63 bit key
+#define SFC_BITS_PER_AXIS 21
+#define SFC_MAX_COORD     ((1<<SFC_BITS_PER_AXIS)-1)
+#define SFC_KEY_LIMIT     (static_cast<vtkTypeUInt64>(1)<<(3*SFC_BITS_PER_AXIS))
+
+//----------------------------------------------------------------------------
+// Spread the lower 21 bits of x so that there are two zero bits between each
+// (magic number interleave, no branches or lookups so the key loop vectorizes)
+//----------------------------------------------------------------------------
+static inline vtkTypeUInt64 SpreadBits3(vtkTypeUInt64 x)
+{
+  x &= 0x1fffff;
+  x = (x | x << 32) & 0x1f00000000ffffULL;
+  x = (x | x << 16) & 0x1f0000ff0000ffULL;
+  x = (x | x << 8)  & 0x100f00f00f00f00fULL;
+  x = (x | x << 4)  & 0x10c30c30c30c30c3ULL;
+  x = (x | x << 2)  & 0x1249249249249249ULL;
+  return x;
+}
+
+//----------------------------------------------------------------------------
+// vtkSFCPartitionFilter :: implementation
+//----------------------------------------------------------------------------
+vtkSFCPartitionFilter::vtkSFCPartitionFilter()
+{
+  this->SamplesPerProcess = 64;
+  this->SplitterTolerance = 0.01;
+}
+//----------------------------------------------------------------------------
+vtkSFCPartitionFilter::~vtkSFCPartitionFilter()
+{
+}
+
+//----------------------------------------------------------------------------
+template <typename T>
+void vtkSFCPartitionFilter::ComputeMortonKeys(
+  const T *pts, vtkIdType N, const double bounds[6], vtkTypeUInt64 *keys)
+{
+  double origin[3], scale[3];
+  for (int j=0; j<3; ++j) {
+    double extent = bounds[2*j+1] - bounds[2*j];
+    origin[j] = bounds[2*j];
+    scale[j]  = extent>0.0 ? SFC_MAX_COORD/extent : 0.0;
+  }
+  const double maxcoord = SFC_MAX_COORD;
+  for (vtkIdType i=0; i<N; ++i) {
+    // clamp rather than test, rounding may put a point on the far boundary outside
+    double fx = std::min(std::max((pts[3*i+0]-origin[0])*scale[0], 0.0), maxcoord);
+    double fy = std::min(std::max((pts[3*i+1]-origin[1])*scale[1], 0.0), maxcoord);
+    double fz = std::min(std::max((pts[3*i+2]-origin[2])*scale[2], 0.0), maxcoord);
+    keys[i] =  SpreadBits3(static_cast<vtkTypeUInt64>(fx))
+            | (SpreadBits3(static_cast<vtkTypeUInt64>(fy)) << 1)
+            | (SpreadBits3(static_cast<vtkTypeUInt64>(fz)) << 2);
+  }
+}
+
+//----------------------------------------------------------------------------
+double vtkSFCPartitionFilter::WeightBelow(const std::vector<vtkTypeUInt64> &sortedKeys,
+  const std::vector<double> &prefixWeights, vtkTypeUInt64 key)
+{
+  vtkIdType below = std::lower_bound(sortedKeys.begin(), sortedKeys.end(), key) - sortedKeys.begin();
+  return prefixWeights[below];
+}
+
+//----------------------------------------------------------------------------
+void vtkSFCPartitionFilter::ComputeSplitters(
+  const std::vector<vtkTypeUInt64> &sortedKeys,
+  const std::vector<double> &prefixWeights,
+  std::vector<vtkTypeUInt64> &splitters)
+{
+  // P curve segments (parts), samples come from R processes
+  const int P = this->NumberOfParts;
+  const int R = this->UpdateNumPieces;
+  const int S = this->SamplesPerProcess;
+  vtkIdType N = static_cast<vtkIdType>(sortedKeys.size());
+  double localWeight = prefixWeights[N], totalWeight = 0.0;
+  this->Controller->AllReduce(&localWeight, &totalWeight, 1, vtkCommunicator::SUM_OP);
+  //
+  splitters.assign(P-1, SFC_KEY_LIMIT);
+  if (P<2 || totalWeight<=0.0) {
+    return;
+  }
+
+  //
+  // 1) Each process takes S keys at regular intervals of its local weight,
+  // each sample represents 1/S of the local weight.
+  //
+  std::vector<vtkTypeUInt64> sampleKeys(S, SFC_KEY_LIMIT);
+  std::vector<double>        sampleWeights(S, 0.0);
+  if (N>0) {
+    for (int j=0; j<S; ++j) {
+      double target = (j+0.5)*localWeight/S;
+      vtkIdType idx = std::upper_bound(prefixWeights.begin()+1, prefixWeights.end(), target) - (prefixWeights.begin()+1);
+      sampleKeys[j]    = sortedKeys[std::min(idx, N-1)];
+      sampleWeights[j] = localWeight/S;
+    }
+  }
+  std::vector<vtkTypeUInt64> allKeys(R*S);
+  std::vector<double>        allWeights(R*S);
+#ifdef VTK_USE_MPI
+  MPI_Allgather(&sampleKeys[0], S, MPI_UINT64_T, &allKeys[0], S, MPI_UINT64_T, this->GetMPIComm());
+#endif
+  this->Controller->AllGather(&sampleWeights[0], &allWeights[0], S);
+
+  // walk the sorted samples and cut where the cumulative weight crosses each
+  // target, the samples on either side of the cut bracket the splitter
+  std::vector<int> order(R*S);
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(),
+    [&allKeys](int a, int b) { return allKeys[a]<allKeys[b]; });
+  std::vector<vtkTypeUInt64> lo(P-1, 0), hi(P-1, SFC_KEY_LIMIT);
+  double cumulative = 0.0;
+  int k = 1;
+  for (int i=0; i<R*S && k<P; ++i) {
+    cumulative += allWeights[order[i]];
+    while (k<P && cumulative>=totalWeight*this->GetPartSizeFraction(0, k)) {
+      splitters[k-1] = allKeys[order[i]];
+      lo[k-1] = (i>0)     ? allKeys[order[i-1]] : 0;
+      hi[k-1] = (i+1<R*S) ? allKeys[order[i+1]] : SFC_KEY_LIMIT;
+      k++;
+    }
+  }
+
+  //
+  // 2) Refine each splitter by bisection of its bracket, one reduction of
+  // P-1 global weight counts per iteration. The samples only estimate the
+  // weights, so the first reduction also counts the weight below both ends
+  // of each bracket and opens an end to the whole key range when the target
+  // lies beyond it.
+  //
+  const int M = P-1;
+  std::vector<double> localBelow(3*M), globalBelow(3*M);
+  double tolerance = this->SplitterTolerance*totalWeight/P;
+  bool counted = false;
+  for (int iteration=0; iteration<=3*SFC_BITS_PER_AXIS+1; ++iteration) {
+    for (int s=0; s<M; ++s) {
+      localBelow[s] = this->WeightBelow(sortedKeys, prefixWeights, splitters[s]);
+      if (iteration==0) {
+        localBelow[M+s]   = this->WeightBelow(sortedKeys, prefixWeights, lo[s]);
+        localBelow[2*M+s] = this->WeightBelow(sortedKeys, prefixWeights, hi[s]);
+      }
+    }
+    this->Controller->AllReduce(&localBelow[0], &globalBelow[0], (iteration==0) ? 3*M : M, vtkCommunicator::SUM_OP);
+    //
+    bool done = true;
+    for (int s=0; s<M; ++s) {
+      double target = totalWeight*this->GetPartSizeFraction(0, s+1);
+      if (iteration==0) {
+        if (globalBelow[M+s]>target)   lo[s] = 0;
+        if (globalBelow[2*M+s]<target) hi[s] = SFC_KEY_LIMIT;
+      }
+      double diff = globalBelow[s] - target;
+      if (std::fabs(diff)<=tolerance) {
+        continue;
+      }
+      if (diff<0.0) {
+        lo[s] = splitters[s];
+      }
+      else {
+        hi[s] = splitters[s];
+      }
+      // many points sharing one key cannot be split, stop when the interval is closed
+      if (hi[s]-lo[s]>1) {
+        splitters[s] = lo[s] + (hi[s]-lo[s])/2;
+        done = false;
+      }
+    }
+    if (done) {
+      counted = true;
+      break;
+    }
+  }
+
+  // splitters converge independently, make sure they remain ordered
+  for (int s=1; s<M; ++s) {
+    if (splitters[s]<splitters[s-1]) {
+      splitters[s] = splitters[s-1];
+      counted = false;
+    }
+  }
+
+  // the imbalance must be that of the final splitters, count them again
+  // if they moved after the last reduction
+  if (!counted) {
+    for (int s=0; s<M; ++s) {
+      localBelow[s] = this->WeightBelow(sortedKeys, prefixWeights, splitters[s]);
+    }
+    this->Controller->AllReduce(&localBelow[0], &globalBelow[0], M, vtkCommunicator::SUM_OP);
+  }
+
+  // partition weights relative to their targets
+  double imbalance = 0.0, previous = 0.0;
+  for (int s=0; s<P; ++s) {
+    double below = (s<M) ? globalBelow[s] : totalWeight;
+    double share = this->GetPartSizeFraction(s, s+1);
+    imbalance = std::max(imbalance, (below-previous)/(totalWeight*(share>0.0 ? share : 1.0/P)));
+    previous = below;
+  }
+  this->ImbalanceValue = static_cast<float>(imbalance);
+}
+
+//----------------------------------------------------------------------------
+void vtkSFCPartitionFilter::ExecuteZoltanPartition(
+    vtkPointSet *output,
+    vtkPointSet *input)
+{
+  vtkIdType N = input->GetNumberOfPoints();
+  vtkBoundingBox globalBounds = this->GetGlobalBounds(input);
+  double bounds[6];
+  globalBounds.GetBounds(bounds);
+
+  //
+  // keys for all local points
+  //
+  std::vector<vtkTypeUInt64> keys(N);
+  if (N>0) {
+    if (this->ZoltanCallbackData.PointType==VTK_FLOAT) {
+      ComputeMortonKeys(static_cast<float*>(this->ZoltanCallbackData.InputPointsData), N, bounds, &keys[0]);
+    }
+    else if (this->ZoltanCallbackData.PointType==VTK_DOUBLE) {
+      ComputeMortonKeys(static_cast<double*>(this->ZoltanCallbackData.InputPointsData), N, bounds, &keys[0]);
+    }
+  }
+
+  //
+  // local sort, keeping track of the original Id
+  //
+  typedef std::pair<vtkTypeUInt64, vtkIdType> key_id;
+  std::vector<key_id> sorted(N);
+  for (vtkIdType i=0; i<N; ++i) {
+    sorted[i] = key_id(keys[i], i);
+  }
+  std::sort(sorted.begin(), sorted.end());
+
+  // keys in sorted order and the (exclusive) prefix sum of their weights
+  const float *weights = (N>0) ? this->GetCriterionWeights(0) : NULL;
+  std::vector<double> prefixWeights(N+1, 0.0);
+  for (vtkIdType i=0; i<N; ++i) {
+    keys[i] = sorted[i].first;
+    prefixWeights[i+1] = prefixWeights[i] + (weights ? weights[sorted[i].second] : 1.0);
+  }
+
+  std::vector<vtkTypeUInt64> splitters;
+  this->ComputeSplitters(keys, prefixWeights, splitters);
+
+  //
+  // sorted keys map to partitions in order, walk both lists together
+  //
+  std::vector<int> parts(N);
+  int part = 0;
+  for (vtkIdType i=0; i<N; ++i) {
+    while (part<this->NumberOfParts-1 && keys[i]>=splitters[part]) {
+      part++;
+    }
+    parts[sorted[i].second] = part;
+  }
+
+  this->SetExportListsFromParts(parts);
+  vtkDebugMacro("SFC partition complete, imbalance " << this->ImbalanceValue);
+}
+
+//----------------------------------------------------------------------------
+void vtkSFCPartitionFilter::GetZoltanBoundingBoxes(vtkBoundingBox &globalBounds)
+{
+  // curve segments are not boxes, use the bounds of the assigned points
+  this->ComputePartitionBoundingBoxes(globalBounds);
+}
+
+//----------------------------------------------------------------------------
+vtkSmartPointer<vtkPKdTree> vtkSFCPartitionFilter::CreatePkdTree()
+{
+  // the partitions are curve segments, there is no tree of cuts
+  this->KdTree = NULL;
+  return NULL;
+}
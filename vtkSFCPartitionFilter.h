@@ -0,0 +1,93 @@
+/*=========================================================================
+
+  Module : vtkSFCPartitionFilter.h
+
+  Copyright (C) CSCS - Swiss National Supercomputing Centre.
+  You may use modify and and distribute this code freely providing
+  1) This copyright notice appears on all copies of source code
+  2) An acknowledgment appears with any substantial usage of the code
+  3) If this code is contributed to any other open source project, it
+  must not be reformatted such that the indentation, bracketing or
+  overall style is modified significantly.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even the
+  implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+=========================================================================*/
+//
+// .NAME vtkSFCPartitionFilter Partition datasets along a space filling curve
+// .SECTION Description
+// vtkSFCPartitionFilter computes the load balance without calling the
+// Zoltan partitioning methods. Each point is given a 63 bit Morton key
+// (21 bits per axis) relative to the global bounds, keys are sorted locally
+// and the key splitters between partitions are found by a parallel sample
+// sort : regular samples of the weighted local keys are gathered to give
+// an initial guess, which is then refined by bisection using global weight
+// counts until the partition weights are within the requested tolerance.
+// Memory use is O(N/P) per rank plus O(P) for the splitters.
+//
+// The export lists and partition boxes produced are the same as those of
+// the Zoltan based filters, so the point/cell migration is unchanged.
+//
+// .SECTION See Also
+// vtkZoltanV1PartitionFilter, vtkZoltanV2PartitionFilter
+//
+#ifndef __vtkSFCPartitionFilter_h
+#define __vtkSFCPartitionFilter_h
+//
+#include "vtkZoltanBasePartitionFilter.h"
+
+//----------------------------------------------------------------------------
+class VTK_EXPORT vtkSFCPartitionFilter : public vtkZoltanBasePartitionFilter
+{
+  public:
+    static vtkSFCPartitionFilter *New();
+    vtkTypeMacro(vtkSFCPartitionFilter, vtkZoltanBasePartitionFilter);
+
+    // Description:
+    // The number of (weighted) key samples each process contributes to the
+    // initial splitter estimate
+    vtkSetClampMacro(SamplesPerProcess, int, 1, 4096);
+    vtkGetMacro(SamplesPerProcess, int);
+
+    // Description:
+    // Splitters are refined until the weight of every partition is within
+    // this fraction of the average partition weight (or cannot be improved)
+    vtkSetClampMacro(SplitterTolerance, double, 0.0, 1.0);
+    vtkGetMacro(SplitterTolerance, double);
+
+  protected:
+     vtkSFCPartitionFilter();
+    ~vtkSFCPartitionFilter();
+
+    virtual void ExecuteZoltanPartition(vtkPointSet *output, vtkPointSet *input);
+    virtual void GetZoltanBoundingBoxes(vtkBoundingBox &globalBounds);
+
+    // Description:
+    // Curve segments are not separated by cuts, so there is no tree to build
+    virtual vtkSmartPointer<vtkPKdTree> CreatePkdTree();
+
+    // Description:
+    // Compute Morton keys for N points quantized to the given bounds
+    template <typename T>
+    static void ComputeMortonKeys(const T *pts, vtkIdType N, const double bounds[6], vtkTypeUInt64 *keys);
+
+    // Description:
+    // Local weight of the sorted keys below key
+    static double WeightBelow(const std::vector<vtkTypeUInt64> &sortedKeys,
+      const std::vector<double> &prefixWeights, vtkTypeUInt64 key);
+
+    // Description:
+    // Find the P-1 key splitters giving equal weight partitions
+    void ComputeSplitters(const std::vector<vtkTypeUInt64> &sortedKeys,
+      const std::vector<double> &prefixWeights, std::vector<vtkTypeUInt64> &splitters);
+
+    int                         SamplesPerProcess;
+    double                      SplitterTolerance;
+
+  private:
+    vtkSFCPartitionFilter(const vtkSFCPartitionFilter&);  // Not implemented.
+    void operator=(const vtkSFCPartitionFilter&);  // Not implemented.
+};
+
+#endif
@@ -37,6 +37,10 @@
 #include "vtkInformationIntegerKey.h"
 #include "vtkFloatArray.h"
 #include "vtkDoubleArray.h"
+#include "vtkIntArray.h"
+#include "vtkIdList.h"
+#include "vtkMultiBlockDataSet.h"
+#include "vtkCompositeDataSet.h"
 //
 // For PARAVIEW_USE_MPI
 #include "vtkPVConfig.h"
@@ -46,8 +50,10 @@
   #include "vtkMPICommunicator.h"
 #endif
 #include "vtkDummyController.h"
+#include <vtksys/SystemInformation.hxx>
 //
 #include "vtkNew.h"
+#include "vtkMinimalStandardRandomSequence.h"
 #include "vtkHexahedron.h"
 #include "vtkPKdTree.h"
 #include "vtkBSPCuts.h"
@@ -105,7 +111,10 @@ int vtkZoltanBasePartitionFilter::size_count = 0;
 //----------------------------------------------------------------------------
 int vtkZoltanBasePartitionFilter::get_number_of_objects_points(void *data, int *ierr)
 {
-  int res = static_cast<CallbackData*>(data)->Input->GetNumberOfPoints();
+  CallbackData *callbackdata = static_cast<CallbackData*>(data);
+  // only the sample points take part when sampling
+  int res = callbackdata->SampleIds.empty() ?
+    callbackdata->Input->GetNumberOfPoints() : static_cast<int>(callbackdata->SampleIds.size());
   *ierr = (res < 0) ? ZOLTAN_FATAL : ZOLTAN_OK;
   return res;
 }
@@ -120,11 +129,16 @@ void vtkZoltanBasePartitionFilter::get_object_list_points(void *data, int sizeGI
     CallbackData *callbackdata = static_cast<CallbackData*>(data);
 
     *ierr = ZOLTAN_OK;
-    vtkIdType N = callbackdata->Input->GetNumberOfPoints();
-    for (vtkIdType i=0; i<N; ++i) {
-        globalID[i] = i + callbackdata->ProcessOffsetsPointId[callbackdata->ProcessRank];
-        if (wgt_dim && callbackdata->self->weights_data_ptr) {
-            obj_wgts[i] = ((float*)callbackdata->self->weights_data_ptr)[i];
+    const std::vector<vtkIdType> &samples = callbackdata->SampleIds;
+    vtkIdType N = samples.empty() ? callbackdata->Input->GetNumberOfPoints() : static_cast<vtkIdType>(samples.size());
+    for (vtkIdType j=0; j<N; ++j) {
+        vtkIdType i = samples.empty() ? j : samples[j];
+        globalID[j] = i + callbackdata->ProcessOffsetsPointId[callbackdata->ProcessRank];
+        // one float array per criterion
+        if (wgt_dim && callbackdata->self->NumberOfWeightCriteria>0) {
+            for (int c=0; c<wgt_dim; ++c) {
+                obj_wgts[j*wgt_dim+c] = callbackdata->self->CriterionWeights[c][i];
+            }
         }
     }
 }
@@ -138,6 +152,66 @@ int vtkZoltanBasePartitionFilter::get_num_geometry(void *data, int *ierr)
   return 3;
 }
 
+//----------------------------------------------------------------------------
+// Zoltan HIER callback : two levels, nodes then the ranks of each node
+//----------------------------------------------------------------------------
+int vtkZoltanBasePartitionFilter::get_hier_num_levels(void *data, int *ierr)
+{
+  *ierr = ZOLTAN_OK;
+  return 2;
+}
+
+//----------------------------------------------------------------------------
+// Zoltan HIER callback : the part this rank computes at each level,
+// its node index then its index among the ranks of the node
+//----------------------------------------------------------------------------
+int vtkZoltanBasePartitionFilter::get_hier_part(void *data, int level, int *ierr)
+{
+  CallbackData *callbackdata = static_cast<CallbackData*>(data);
+  vtkZoltanBasePartitionFilter *self = callbackdata->self;
+  int rank = callbackdata->ProcessRank;
+  *ierr = ZOLTAN_OK;
+  if (level==0) {
+    return self->NodeOfRank[rank];
+  }
+  return static_cast<int>(std::count(self->NodeOfRank.begin(), self->NodeOfRank.begin()+rank, self->NodeOfRank[rank]));
+}
+
+//----------------------------------------------------------------------------
+// Zoltan HIER callback : the same geometric method is used at both levels
+//----------------------------------------------------------------------------
+void vtkZoltanBasePartitionFilter::get_hier_method(void *data, int level, struct Zoltan_Struct *zz, int *ierr)
+{
+  CallbackData *callbackdata = static_cast<CallbackData*>(data);
+  vtkZoltanBasePartitionFilter *self = callbackdata->self;
+  switch (self->PartitionMethod) {
+    case vtkZoltanBasePartitionFilter::RIB:
+      Zoltan_Set_Param(zz, "LB_METHOD", "RIB");
+      break;
+    case vtkZoltanBasePartitionFilter::HSFC:
+      Zoltan_Set_Param(zz, "LB_METHOD", "HSFC");
+      break;
+    default:
+      Zoltan_Set_Param(zz, "LB_METHOD", "RCB");
+      Zoltan_Set_Param(zz, "RCB_OUTPUT_LEVEL", "0");
+      Zoltan_Set_Param(zz, "RCB_RECTILINEAR_BLOCKS", "1");
+      break;
+  }
+  *ierr = ZOLTAN_OK;
+}
+
+//----------------------------------------------------------------------------
+// Zoltan_Migrate uses multi object size/pack/unpack functions in preference
+// to the single object ones, remove them before a migration which registers
+// single object callbacks
+//----------------------------------------------------------------------------
+void vtkZoltanBasePartitionFilter::ClearMultiMigrateFunctions(struct Zoltan_Struct *zz)
+{
+  Zoltan_Set_Fn(zz, ZOLTAN_OBJ_SIZE_MULTI_FN_TYPE,   NULL, NULL);
+  Zoltan_Set_Fn(zz, ZOLTAN_PACK_OBJ_MULTI_FN_TYPE,   NULL, NULL);
+  Zoltan_Set_Fn(zz, ZOLTAN_UNPACK_OBJ_MULTI_FN_TYPE, NULL, NULL);
+}
+
 //----------------------------------------------------------------------------
 // Zoltan callback which does nothing, we register this during load balance
 // when we do not want any pre migration operations (we manually handle it)
@@ -165,14 +239,51 @@ vtkZoltanBasePartitionFilter::vtkZoltanBasePartitionFilter()
   this->ZoltanData                     = NULL;
   this->InputDisposable                = 0;
   this->KeepInversePointLists          = 0;
+  this->IncrementalPartitioning        = 0;
+  this->PartitionMethod                = vtkZoltanBasePartitionFilter::RCB;
+  this->NumberOfObjectsKept            = 0;
+  this->NumberOfObjectsMigrated        = 0;
+  this->NumberOfObjectsMigratedOffNode = 0;
+  this->MigrationCostAware             = 0;
+  this->RepartitionMultiplier          = 100.0;
+  this->PointBytes                     = 0;
+  this->NumberOfBytesMigrated          = 0;
+  this->ImbalanceThreshold             = 0.0;
+  this->PartitionSkipped               = 0;
+  this->BalancedThreshold              = 0.0;
+  this->SkippingPartition              = false;
+  this->MigrationTransport             = vtkZoltanBasePartitionFilter::ZoltanTransport;
+  this->MaxMigrationBufferBytes        = 0;
+  this->PeakMigrationBufferBytes       = 0;
+  this->NumberOfMigrationRounds        = 0;
+  this->SparseMigrationFraction        = 0.25;
+  this->SparseMigrationUsed            = 0;
+  this->HierarchicalPartitioning       = 0;
+  this->VirtualRanksPerNode            = 0;
+  this->NumberOfNodes                  = 1;
+  this->RanksPerNode                   = 0;
+  this->NodeRanksContiguous            = true;
+  this->UseNodeHierarchy               = false;
+  this->PiecesPerProcess               = 1;
+  this->PartsPerProcess                = 1;
+  this->NumberOfParts                  = 1;
+  this->AutoCapacity                   = 0;
+  this->PieceExtentTranslator          = vtkSmartPointer<vtkBoundsExtentTranslator>::New();
   this->PointWeightsArrayName          = NULL;
-  this->weights_data_ptr               = NULL;
+  this->MultiCriteriaNorm              = 1;
+  this->NumberOfWeightCriteria         = 0;
+  this->SampleFraction                 = 0.0;
+  this->SampleTargetCount              = 0;
+  this->NumberOfSamplePoints           = 0;
+  this->SampleImbalance                = 1.0;
   this->ImbalanceValue                 =-1.0; // invalid
   this->Controller                     = NULL;
   this->SetController(vtkMultiProcessController::GetGlobalController());
   if (this->Controller == NULL) {
     this->SetController(vtkSmartPointer<vtkDummyController>::New());
   }
+  // the second output holds the pieces of this process
+  this->SetNumberOfOutputPorts(2);
 }
 //----------------------------------------------------------------------------
 vtkZoltanBasePartitionFilter::~vtkZoltanBasePartitionFilter()
@@ -188,6 +299,11 @@ vtkZoltanBasePartitionFilter::~vtkZoltanBasePartitionFilter()
     // set to zero so we know data has been deleted
     this->MigrateLists.num_found = -1;
   }
+  // the zoltan structure may have been retained between executions
+  if (this->ZoltanData) {
+    Zoltan_Destroy(&this->ZoltanData);
+    this->ZoltanData = NULL;
+  }
   //
   this->SetPointWeightsArrayName(NULL);
   //
@@ -210,13 +326,41 @@ int vtkZoltanBasePartitionFilter::FillInputPortInformation(int, vtkInformation*
 
 //----------------------------------------------------------------------------
 int vtkZoltanBasePartitionFilter::FillOutputPortInformation(
-  int vtkNotUsed(port), vtkInformation* info)
+  int port, vtkInformation* info)
 {
+  if (port==1) {
+    info->Set(vtkDataObject::DATA_TYPE_NAME(), "vtkMultiBlockDataSet");
+    return 1;
+  }
   // output should be the same as the input (a subclass of vtkPointSet)
   info->Set(vtkDataObject::DATA_TYPE_NAME(), "vtkPointSet");
   return 1;
 }
 
+//----------------------------------------------------------------------------
+int vtkZoltanBasePartitionFilter::RequestDataObject(
+  vtkInformation* request,
+  vtkInformationVector** inputVector,
+  vtkInformationVector* outputVector)
+{
+  // the superclass makes every output a copy of the input type
+  if (!this->Superclass::RequestDataObject(request, inputVector, outputVector)) {
+    return 0;
+  }
+  vtkInformation *info = outputVector->GetInformationObject(1);
+  if (!vtkMultiBlockDataSet::SafeDownCast(info->Get(vtkDataObject::DATA_OBJECT()))) {
+    vtkSmartPointer<vtkMultiBlockDataSet> pieces = vtkSmartPointer<vtkMultiBlockDataSet>::New();
+    info->Set(vtkDataObject::DATA_OBJECT(), pieces);
+  }
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+vtkMultiBlockDataSet *vtkZoltanBasePartitionFilter::GetPiecesOutput()
+{
+  return vtkMultiBlockDataSet::SafeDownCast(this->GetOutputDataObject(1));
+}
+
 //----------------------------------------------------------------------------
 vtkBoundingBox *vtkZoltanBasePartitionFilter::GetPartitionBoundingBox(int partition)
 {
@@ -227,6 +371,16 @@ vtkBoundingBox *vtkZoltanBasePartitionFilter::GetPartitionBoundingBox(int partit
   return NULL;
 }
 
+//----------------------------------------------------------------------------
+vtkBoundingBox *vtkZoltanBasePartitionFilter::GetPieceBoundingBox(int piece)
+{
+  if (piece>=0 && piece<static_cast<int>(this->PieceBoxList.size())) {
+    return &this->PieceBoxList[piece];
+  }
+  vtkErrorMacro("Piece not found in Bounding Box list");
+  return NULL;
+}
+
 //----------------------------------------------------------------------------
 vtkBoundingBox *vtkZoltanBasePartitionFilter::GetPartitionBoundingBoxHalo(int partition)
 {
@@ -416,24 +570,113 @@ void vtkZoltanBasePartitionFilter::AllocateFieldArrays(vtkDataSetAttributes *fie
   vtkDebugMacro("AllocateFieldArrays completed");
 }
 
+//-------------------------------------------------------------------------
+void vtkZoltanBasePartitionFilter::AddPointWeightsArrayName(const char *name)
+{
+  if (!name || !*name) {
+    return;
+  }
+  this->PointWeightsArrayNames.push_back(name);
+  this->Modified();
+}
+//-------------------------------------------------------------------------
+void vtkZoltanBasePartitionFilter::ClearPointWeightsArrayNames()
+{
+  if (this->PointWeightsArrayNames.empty()) {
+    return;
+  }
+  this->PointWeightsArrayNames.clear();
+  this->Modified();
+}
+//-------------------------------------------------------------------------
+void vtkZoltanBasePartitionFilter::AddProcessCapacity(double capacity)
+{
+  this->ProcessCapacities.push_back(std::max(capacity, 0.0));
+  this->Modified();
+}
+//-------------------------------------------------------------------------
+void vtkZoltanBasePartitionFilter::ClearProcessCapacities()
+{
+  if (this->ProcessCapacities.empty()) {
+    return;
+  }
+  this->ProcessCapacities.clear();
+  this->Modified();
+}
+//-------------------------------------------------------------------------
+double vtkZoltanBasePartitionFilter::GetProcessTargetFraction(int rank)
+{
+  if (rank<0 || rank>=this->NumberOfParts/this->PartsPerProcess) {
+    return 0.0;
+  }
+  return this->GetPartSizeFraction(rank*this->PartsPerProcess, (rank+1)*this->PartsPerProcess);
+}
+//-------------------------------------------------------------------------
+double vtkZoltanBasePartitionFilter::GetCriterionImbalance(int criterion)
+{
+  if (criterion<0 || criterion>=static_cast<int>(this->CriterionImbalance.size())) {
+    return -1.0; // invalid
+  }
+  return this->CriterionImbalance[criterion];
+}
 //-------------------------------------------------------------------------
 void vtkZoltanBasePartitionFilter::SetupPointWeights(vtkDataSetAttributes *fields) {
-    // get the array that is used for weights, check it the same as coords because
-    // @TODO, zoltan only allows one template param for coords and weights
-    // so we can't use different types yet
-    vtkDataArray *weightsArray = this->PointWeightsArrayName ?
-        fields->GetArray(this->PointWeightsArrayName) : NULL;
-    this->weights_data_ptr = NULL;
+    this->NumberOfWeightCriteria = 0;
+    this->CriterionArrays.clear();
+    this->CriterionWeights.clear();
+    this->ConvertedWeights.clear();
     //
-    if (weightsArray && (VTK_FLOAT != weightsArray->GetDataType())) {
-        vtkWarningMacro(<<"Weights datatype must be the same as coordinate type");
-        weightsArray = NULL;
+    // the single weights array followed by any extra criteria, each used once
+    //
+    std::vector<std::string> names;
+    if (this->PointWeightsArrayName) {
+        names.push_back(this->PointWeightsArrayName);
+    }
+    for (size_t i=0; i<this->PointWeightsArrayNames.size(); ++i) {
+        if (std::find(names.begin(), names.end(), this->PointWeightsArrayNames[i])==names.end()) {
+            names.push_back(this->PointWeightsArrayNames[i]);
+        }
     }
-    if (weightsArray) {
-        // get the pointer to the actual data, if the array is empty, set the pointer
-        // to some non NULL value so that later checks for weights present don't fail
-        this->weights_data_ptr = weightsArray->GetVoidPointer(0) ? weightsArray->GetVoidPointer(0) : (void*)0xFFFFFFFF;
+    for (size_t i=0; i<names.size(); ++i) {
+        vtkDataArray *weightsArray = fields->GetArray(names[i].c_str());
+        if (!weightsArray || weightsArray->GetNumberOfComponents()!=1) {
+            vtkWarningMacro(<<"Weights array " << names[i].c_str() << " not found or not scalar");
+            continue;
+        }
+        this->CriterionArrays.push_back(weightsArray);
     }
+
+    //
+    // Zoltan and the native partitioners take float weights, float arrays are
+    // used in place and any other numeric type is converted once
+    //
+    int dim = static_cast<int>(this->CriterionArrays.size());
+    vtkIdType N = fields->GetNumberOfTuples();
+    this->CriterionWeights.assign(dim, static_cast<const float*>(NULL));
+    this->ConvertedWeights.resize(dim);
+    for (int c=0; c<dim; ++c) {
+        vtkDataArray *weightsArray = this->CriterionArrays[c];
+        if (N==0) {
+            continue;
+        }
+        if (weightsArray->GetDataType()==VTK_FLOAT) {
+            this->CriterionWeights[c] = static_cast<const float*>(weightsArray->GetVoidPointer(0));
+            continue;
+        }
+        std::vector<float> &converted = this->ConvertedWeights[c];
+        converted.resize(N);
+        switch (weightsArray->GetDataType()) {
+            vtkTemplateMacro(
+                vtkZoltanBasePartitionFilter::ConvertWeights(
+                    static_cast<const VTK_TT*>(weightsArray->GetVoidPointer(0)), N, &converted[0]));
+            default:
+                vtkWarningMacro(<<"Weights array " << weightsArray->GetName() << " is not numeric");
+                converted.assign(N, 1.0f);
+        }
+        this->CriterionWeights[c] = &converted[0];
+    }
+    this->NumberOfWeightCriteria = dim;
+    vtkDebugMacro("Number of weight criteria " << this->NumberOfWeightCriteria);
 }
 //-------------------------------------------------------------------------
 int vtkZoltanBasePartitionFilter::RequestUpdateExtent(
@@ -480,6 +723,8 @@ int vtkZoltanBasePartitionFilter::RequestInformation(
   vtkInformation *outInfo = outputVector->GetInformationObject(0);
 
   outInfo->Set(vtkBoundsExtentTranslator::META_DATA(), this->ExtentTranslator);
+  outputVector->GetInformationObject(1)->Set(
+    vtkBoundsExtentTranslator::META_DATA(), this->PieceExtentTranslator);
   //
   //outInfo->Set(vtkBoundsExtentTranslator::META_DATA(),
   //             inInfo->Get(vtkBoundsExtentTranslator::META_DATA()));
@@ -505,7 +750,18 @@ void vtkZoltanBasePartitionFilter::InitializeZoltanLoadBalance()
   //* Guide for the definition of these and many other parameters.
   //***************************************************************
 
-  this->ZoltanData = Zoltan_Create(this->GetMPIComm());
+  //
+  // In incremental mode the structure from the previous execution is reused,
+  // it holds the RCB cuts which are used as the starting point for the new
+  // partition. Otherwise any structure left over is discarded.
+  //
+  if (this->ZoltanData && !this->IncrementalPartitioning) {
+    Zoltan_Destroy(&this->ZoltanData);
+    this->ZoltanData = NULL;
+  }
+  if (!this->ZoltanData) {
+    this->ZoltanData = Zoltan_Create(this->GetMPIComm());
+  }
 
   // we don't need any debug info
   Zoltan_Set_Param(this->ZoltanData, "RCB_OUTPUT_LEVEL", "0");
@@ -513,7 +769,26 @@ void vtkZoltanBasePartitionFilter::InitializeZoltanLoadBalance()
 
   // Method for subdivision
   Zoltan_Set_Param(this->ZoltanData, "LB_APPROACH", "REPARTITION");
-  Zoltan_Set_Param(this->ZoltanData, "LB_METHOD", "RCB");
+  switch (this->PartitionMethod) {
+    case vtkZoltanBasePartitionFilter::RIB:
+      Zoltan_Set_Param(this->ZoltanData, "LB_METHOD", "RIB");
+      break;
+    case vtkZoltanBasePartitionFilter::HSFC:
+      Zoltan_Set_Param(this->ZoltanData, "LB_METHOD", "HSFC");
+      break;
+    default:
+      // Zoltan has no multi-jagged method, RCB is the closest equivalent
+      Zoltan_Set_Param(this->ZoltanData, "LB_METHOD", "RCB");
+      break;
+  }
+  if (this->UseZoltanHierarchy()) {
+    // nodes first, then the ranks of each node, see get_hier_method
+    vtkDebugMacro("Hierarchical partition over " << this->NumberOfNodes << " nodes");
+    Zoltan_Set_Param(this->ZoltanData, "LB_METHOD", "HIER");
+    Zoltan_Set_Hier_Num_Levels_Fn(this->ZoltanData, get_hier_num_levels, &this->ZoltanCallbackData);
+    Zoltan_Set_Hier_Part_Fn(this->ZoltanData, get_hier_part, &this->ZoltanCallbackData);
+    Zoltan_Set_Hier_Method_Fn(this->ZoltanData, get_hier_method, &this->ZoltanCallbackData);
+  }
   //  Zoltan_Set_Param(this->ZoltanData, "LB_METHOD", "PARMETIS");
 
   // Global and local Ids are a single integer
@@ -522,16 +797,29 @@ void vtkZoltanBasePartitionFilter::InitializeZoltanLoadBalance()
 
   // divide into N global and M local partitions
   std::stringstream global;
-  global << this->UpdateNumPieces << ends;
-  // just one local piece for now
+  global << this->NumberOfParts << ends;
   std::stringstream local;
-  local << 1 << ends;
+  local << this->PartsPerProcess << ends;
   //
-//  Zoltan_Set_Param(this->ZoltanData, "NUM_GLOBAL_PARTS", global.str().c_str());
-//  Zoltan_Set_Param(this->ZoltanData, "NUM_LOCAL_PARTS",  local.str().c_str());
+  Zoltan_Set_Param(this->ZoltanData, "NUM_GLOBAL_PARTS", global.str().c_str());
+  Zoltan_Set_Param(this->ZoltanData, "NUM_LOCAL_PARTS",  local.str().c_str());
 
   // if we have weights, turn on weight
-  if(this->weights_data_ptr) {
+  if (this->NumberOfWeightCriteria>1 &&
+      this->PartitionMethod!=vtkZoltanBasePartitionFilter::RIB &&
+      this->PartitionMethod!=vtkZoltanBasePartitionFilter::HSFC) {
+      // one weight per criterion, RCB balances them together using the chosen norm
+      std::stringstream dim, norm;
+      dim << this->NumberOfWeightCriteria << std::ends;
+      norm << this->MultiCriteriaNorm << std::ends;
+      vtkDebugMacro("Setting zoltan weights dimension " << this->NumberOfWeightCriteria);
+      Zoltan_Set_Param(this->ZoltanData, "OBJ_WEIGHT_DIM", dim.str().c_str());
+      Zoltan_Set_Param(this->ZoltanData, "RCB_MULTICRITERIA_NORM", norm.str().c_str());
+  }
+  else if(this->NumberOfWeightCriteria>0) {
+      if (this->NumberOfWeightCriteria>1) {
+          vtkWarningMacro(<<"Multi-criteria weights need RCB, only the first criterion is balanced");
+      }
       vtkDebugMacro("Setting zoltan weights dimension 1");
       Zoltan_Set_Param(this->ZoltanData, "OBJ_WEIGHT_DIM", "1");
   }
@@ -540,8 +828,40 @@ void vtkZoltanBasePartitionFilter::InitializeZoltanLoadBalance()
       Zoltan_Set_Param(this->ZoltanData, "OBJ_WEIGHT_DIM", "0");
   }
 
-  // we need the import and export lists
-  Zoltan_Set_Param(this->ZoltanData, "RETURN_LISTS", "IMPORT AND EXPORT");
+  // part sizes from the process capacities, the same for every weight
+  // dimension, a retained structure must be reset to equal sizes
+  if (this->PartSizes.empty()) {
+    Zoltan_LB_Set_Part_Sizes(this->ZoltanData, 1, -1, NULL, NULL, NULL);
+  }
+  else {
+    int weightDim = (this->NumberOfWeightCriteria>1 &&
+      this->PartitionMethod!=vtkZoltanBasePartitionFilter::RIB &&
+      this->PartitionMethod!=vtkZoltanBasePartitionFilter::HSFC) ? this->NumberOfWeightCriteria : 1;
+    std::vector<int>   partIds, weightIds;
+    std::vector<float> sizes;
+    for (int w=0; w<weightDim; ++w) {
+      for (int part=0; part<this->NumberOfParts; ++part) {
+        partIds.push_back(part);
+        weightIds.push_back(w);
+        sizes.push_back(static_cast<float>(this->PartSizes[part]));
+      }
+    }
+    Zoltan_LB_Set_Part_Sizes(this->ZoltanData, 1, static_cast<int>(sizes.size()),
+      &partIds[0], &weightIds[0], &sizes[0]);
+  }
+
+  // we need the import and export lists, with several parts per process
+  // the part of every object (also those staying here) is needed instead
+  Zoltan_Set_Param(this->ZoltanData, "RETURN_LISTS",
+    this->PartsPerProcess>1 ? "PARTS" : "IMPORT AND EXPORT");
+
+  // migration cost : parts renumbered to keep the most points in place,
+  // this is also Zoltan's default so REMAP is only touched when asked for.
+  // All points migrate the same bytes and the geometric methods ignore object
+  // sizes, the cost is only traded against the cut for cell graphs.
+  if (this->MigrationCostAware) {
+    Zoltan_Set_Param(this->ZoltanData, "REMAP", "1");
+  }
 
   // RCB parameters
   // Zoltan_Set_Param(this->ZoltanData, "PARMETIS_METHOD", "PARTKWAY");
@@ -556,6 +876,9 @@ void vtkZoltanBasePartitionFilter::InitializeZoltanLoadBalance()
   // we need the cuts to get BBoxes for partitions later
   Zoltan_Set_Param(this->ZoltanData, "KEEP_CUTS", "1");
 
+  // start from the previous cuts when repartitioning (ignored on first use)
+  Zoltan_Set_Param(this->ZoltanData, "RCB_REUSE", this->IncrementalPartitioning ? "1" : "0");
+
   // don't allow points on cut to be in different partitions
   // not likely/useful for particle data anyway
   Zoltan_Set_Param(this->ZoltanData, "RCB_RECTILINEAR_BLOCKS", "1");
@@ -620,6 +943,10 @@ int vtkZoltanBasePartitionFilter::PartitionPoints(vtkInformation*,
   //--------------------------------------------------------------
   this->LoadBalanceData.numImport=0;
   this->LoadBalanceData.numExport=0;
+  this->PartitionSkipped = 0;
+  this->PeakMigrationBufferBytes = 0;
+  this->NumberOfMigrationRounds  = 1;
+  this->SparseMigrationUsed = 0;
   this->LoadBalanceData.importGlobalGids = NULL;
   this->LoadBalanceData.importLocalGids  = NULL;
   this->LoadBalanceData.exportGlobalGids = NULL;
@@ -655,6 +982,13 @@ int vtkZoltanBasePartitionFilter::PartitionPoints(vtkInformation*,
     this->ExtentTranslator->SetNumberOfPieces(1);
     this->ExtentTranslator->SetBoundsForPiece(0, globalBounds);
     this->ExtentTranslator->InitWholeBounds();
+    this->PartsPerProcess = 1;
+    this->NumberOfParts   = 1;
+    this->PartSizes.clear();
+    this->GroupPieceBoundingBoxes();
+    this->NumberOfObjectsKept     = numPoints;
+    this->NumberOfObjectsMigrated = 0;
+    this->NumberOfBytesMigrated   = 0;
     return 1;
   }
 
@@ -701,6 +1035,16 @@ int vtkZoltanBasePartitionFilter::PartitionPoints(vtkInformation*,
   vtkDebugMacro("Setting up weights array");
   this->SetupPointWeights(this->ZoltanCallbackData.InputPointData);
 
+  //
+  // which node each rank is on, for hierarchical partitioning and statistics
+  //
+  this->PartsPerProcess = this->PiecesPerProcess;
+  this->NumberOfParts   = this->PartsPerProcess*this->UpdateNumPieces;
+  this->PointParts.clear();
+  this->ComputeNodeTopology();
+  this->ComputePartSizes();
+  this->ComputePointBytes();
+
   //
   // Set all the callbacks and user config parameters that will be used during the loadbalance
   //
@@ -719,7 +1063,14 @@ int vtkZoltanBasePartitionFilter::PartitionPoints(vtkInformation*,
   if (this->InputExtentTranslator && this->InputExtentTranslator->GetNumberOfPieces()==0) {
     this->InputExtentTranslator = NULL;
   }
-  this->ExtentTranslator->SetNumberOfPieces(this->UpdateNumPieces);
+  if (this->InputExtentTranslator && this->PartsPerProcess>1) {
+    vtkWarningMacro("Input is already partitioned, one piece per process is used");
+    this->PartsPerProcess = 1;
+    this->NumberOfParts   = this->UpdateNumPieces;
+    this->PartSizes.clear();
+  }
+  // boxes are computed per part, GroupPieceBoundingBoxes regroups them per process
+  this->ExtentTranslator->SetNumberOfPieces(this->NumberOfParts);
 
   //
   // if the input had a BoundsExtentTranslator, we can assume that all points and cells
@@ -750,7 +1101,19 @@ int vtkZoltanBasePartitionFilter::PartitionPoints(vtkInformation*,
       this->ExtentTranslator->SetBoundsForPiece(p, this->InputExtentTranslator->GetBoundsForPiece(p));
     }
   }
+  else if (this->IsAlreadyBalanced(numPoints, globalBounds)) {
+    //
+    // every point stays where it is, the export lists are empty and the
+    // boxes (used for the halos) are the disjoint bounds of each process
+    //
+    this->NumberOfSamplePoints = 0;
+    this->SampleImbalance      = 1.0;
+    this->ImbalanceValue       = static_cast<float>(this->CriterionImbalance[0]);
+    vtkDebugMacro("Partition skipped, imbalance " << this->ImbalanceValue);
+  }
   else {
+    this->NumberOfSamplePoints = 0;
+    this->SampleImbalance      = 1.0;
     this->ExecuteZoltanPartition(output, input);
 
     vtkDebugMacro("Partitioning "  <<
@@ -760,10 +1123,605 @@ int vtkZoltanBasePartitionFilter::PartitionPoints(vtkInformation*,
 
     this->GetZoltanBoundingBoxes(globalBounds);
 
+    this->ComputeCriterionImbalance(numPoints);
+    if (this->NumberOfSamplePoints>0) {
+      vtkDebugMacro("Cuts computed from " << this->NumberOfSamplePoints << " sample points"
+        << " sample imbalance " << this->SampleImbalance
+        << " point imbalance " << this->CriterionImbalance[0]);
+    }
+
+    if (this->PartsPerProcess>1) {
+      // the piece of every point travels with it as a point field
+      vtkSmartPointer<vtkIntArray> partIds = vtkSmartPointer<vtkIntArray>::New();
+      partIds->SetName("vtkPartitionId");
+      partIds->SetNumberOfTuples(numPoints);
+      if (numPoints>0) {
+        std::copy(this->PointParts.begin(), this->PointParts.end(), partIds->GetPointer(0));
+      }
+      this->ZoltanCallbackData.InputPointData->AddArray(partIds);
+    }
   }
+  this->GroupPieceBoundingBoxes();
+  this->ComputeMigrationStatistics(numPoints);
+  vtkDebugMacro("Partitioning "  <<
+      " kept : " << this->NumberOfObjectsKept <<
+      " migrated : " << this->NumberOfObjectsMigrated
+  );
   return 1;
 }
 
+//----------------------------------------------------------------------------
+template <typename T>
+static void ComputeBoundsOfParts(const T *pts, const std::vector<int> &parts,
+  std::vector<double> &mins, std::vector<double> &maxs)
+{
+  for (size_t i=0; i<parts.size(); ++i) {
+    const T *p = &pts[3*i];
+    double *bmin = &mins[3*parts[i]];
+    double *bmax = &maxs[3*parts[i]];
+    for (int j=0; j<3; ++j) {
+      bmin[j] = std::min(bmin[j], static_cast<double>(p[j]));
+      bmax[j] = std::max(bmax[j], static_cast<double>(p[j]));
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkZoltanBasePartitionFilter::ComputePartitionBoundingBoxes(vtkBoundingBox &globalBounds)
+{
+  //
+  // Every point stays here unless it is in the export list
+  //
+  vtkIdType N = this->ZoltanCallbackData.Input->GetNumberOfPoints();
+  std::vector<int> parts(N, this->UpdatePiece);
+  if (this->PartsPerProcess>1) {
+    parts = this->PointParts;
+  }
+  else {
+    vtkIdType offset = this->ZoltanCallbackData.ProcessOffsetsPointId[this->ZoltanCallbackData.ProcessRank];
+    for (int i=0; i<this->LoadBalanceData.numExport; ++i) {
+      parts[this->LoadBalanceData.exportGlobalGids[i] - offset] = this->LoadBalanceData.exportProcs[i];
+    }
+  }
+
+  const int nparts = this->NumberOfParts;
+  std::vector<double> mins(3*nparts,  VTK_DOUBLE_MAX), globalMins(3*nparts);
+  std::vector<double> maxs(3*nparts, VTK_DOUBLE_MIN), globalMaxs(3*nparts);
+  if (N>0) {
+    if (this->ZoltanCallbackData.PointType==VTK_FLOAT) {
+      ComputeBoundsOfParts(static_cast<float*>(this->ZoltanCallbackData.InputPointsData), parts, mins, maxs);
+    }
+    else if (this->ZoltanCallbackData.PointType==VTK_DOUBLE) {
+      ComputeBoundsOfParts(static_cast<double*>(this->ZoltanCallbackData.InputPointsData), parts, mins, maxs);
+    }
+  }
+  this->Controller->AllReduce(&mins[0], &globalMins[0], 3*nparts, vtkCommunicator::MIN_OP);
+  this->Controller->AllReduce(&maxs[0], &globalMaxs[0], 3*nparts, vtkCommunicator::MAX_OP);
+
+  //
+  // partitions which received no points are left as invalid boxes
+  //
+  this->BoxList.clear();
+  for (int p=0; p<nparts; p++) {
+    vtkBoundingBox box;
+    if (globalMins[3*p]<=globalMaxs[3*p]) {
+      box.SetMinPoint(&globalMins[3*p]);
+      box.SetMaxPoint(&globalMaxs[3*p]);
+    }
+    double bounds[6];
+    box.GetBounds(bounds);
+    this->BoxList.push_back(box);
+    this->ExtentTranslator->SetBoundsForPiece(p, bounds);
+  }
+  this->ExtentTranslator->InitWholeBounds();
+}
+
+//----------------------------------------------------------------------------
+void vtkZoltanBasePartitionFilter::ComputeMigrationStatistics(vtkIdType numObjects)
+{
+  // MIGRATE_ONLY_PROC_CHANGES is set, so the export list holds only objects
+  // which really leave this process
+  vtkIdType local[4], global[4];
+  local[1] = this->LoadBalanceData.numExport;
+  local[0] = numObjects - local[1];
+  local[2] = 0;
+  local[3] = local[1]*this->PointBytes;
+  if (static_cast<int>(this->NodeOfRank.size())==this->UpdateNumPieces) {
+    int node = this->NodeOfRank[this->UpdatePiece];
+    for (int i=0; i<this->LoadBalanceData.numExport; ++i) {
+      if (this->NodeOfRank[this->LoadBalanceData.exportProcs[i]]!=node) {
+        local[2]++;
+      }
+    }
+  }
+  this->Controller->AllReduce(local, global, 4, vtkCommunicator::SUM_OP);
+  this->NumberOfObjectsKept            = global[0];
+  this->NumberOfObjectsMigrated        = global[1];
+  this->NumberOfObjectsMigratedOffNode = global[2];
+  this->NumberOfBytesMigrated          = global[3];
+}
+
+//----------------------------------------------------------------------------
+void vtkZoltanBasePartitionFilter::UpdatePeakMigrationBuffer(vtkIdType bytes, const char *unbounded)
+{
+  vtkIdType peak = 0;
+  this->Controller->AllReduce(&bytes, &peak, 1, vtkCommunicator::MAX_OP);
+  this->PeakMigrationBufferBytes = std::max(this->PeakMigrationBufferBytes, peak);
+  if (unbounded && this->MaxMigrationBufferBytes>0 && peak>this->MaxMigrationBufferBytes && this->UpdatePiece==0) {
+    vtkWarningMacro(<< unbounded << " uses Zoltan_Migrate which cannot be split into rounds, its buffers ("
+      << peak << " bytes) exceed MaxMigrationBufferBytes");
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkZoltanBasePartitionFilter::SetVirtualRanksPerNode(int ranks)
+{
+  ranks = std::max(ranks, 0);
+  if (this->VirtualRanksPerNode!=ranks) {
+    this->VirtualRanksPerNode = ranks;
+    // the nodes are found again at the next execution
+    this->NodeOfRank.clear();
+    this->Modified();
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkZoltanBasePartitionFilter::ComputeNodeTopology()
+{
+  int P = this->UpdateNumPieces;
+  if (static_cast<int>(this->NodeOfRank.size())!=P) {
+    this->NodeOfRank.assign(P, 0);
+    if (this->VirtualRanksPerNode>0) {
+      // emulated nodes of consecutive ranks
+      for (int p=0; p<P; ++p) {
+        this->NodeOfRank[p] = p/this->VirtualRanksPerNode;
+      }
+    }
+#if defined(VTK_USE_MPI) && MPI_VERSION>=3
+    else {
+      //
+      // ranks sharing memory form a node, node leaders (lowest rank of each node)
+      // are numbered in rank order and the number is shared with the node
+      //
+      MPI_Comm comm = this->GetMPIComm();
+      MPI_Comm nodeComm;
+      MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, this->UpdatePiece, MPI_INFO_NULL, &nodeComm);
+      int nodeRank, leader, node = 0;
+      MPI_Comm_rank(nodeComm, &nodeRank);
+      leader = (nodeRank==0) ? 1 : 0;
+      MPI_Exscan(&leader, &node, 1, MPI_INT, MPI_SUM, comm);
+      if (this->UpdatePiece==0) {
+        node = 0; // Exscan result is undefined on rank 0
+      }
+      MPI_Bcast(&node, 1, MPI_INT, 0, nodeComm);
+      MPI_Comm_free(&nodeComm);
+      MPI_Allgather(&node, 1, MPI_INT, &this->NodeOfRank[0], 1, MPI_INT, comm);
+    }
+#else
+    else {
+      // shared memory communicators need MPI 3, every rank is its own node
+      for (int p=0; p<P; ++p) {
+        this->NodeOfRank[p] = p;
+      }
+    }
+#endif
+    this->NumberOfNodes = *std::max_element(this->NodeOfRank.begin(), this->NodeOfRank.end()) + 1;
+    std::vector<int> counts(this->NumberOfNodes, 0);
+    this->NodeRanksContiguous = true;
+    for (int p=0; p<P; ++p) {
+      counts[this->NodeOfRank[p]]++;
+      if (p>0 && this->NodeOfRank[p]<this->NodeOfRank[p-1]) {
+        this->NodeRanksContiguous = false;
+      }
+    }
+    this->RanksPerNode = counts[0];
+    for (int n=1; n<this->NumberOfNodes; ++n) {
+      if (counts[n]!=this->RanksPerNode) {
+        this->RanksPerNode = 0;
+      }
+    }
+  }
+  // with one node, or one rank per node, the hierarchy is the flat partition
+  this->UseNodeHierarchy = this->HierarchicalPartitioning &&
+    this->NumberOfNodes>1 && this->NumberOfNodes<P;
+  vtkDebugMacro("Nodes " << this->NumberOfNodes << " ranks per node " << this->RanksPerNode
+    << " hierarchy " << this->UseNodeHierarchy);
+}
+
+//----------------------------------------------------------------------------
+void vtkZoltanBasePartitionFilter::ComputePointBytes()
+{
+  vtkDataSetAttributes *fields = this->ZoltanCallbackData.InputPointData;
+  this->PointBytes = 3*vtkDataArray::GetDataTypeSize(this->ZoltanCallbackData.PointType);
+  for (int i=0; fields && i<fields->GetNumberOfArrays(); ++i) {
+    vtkDataArray *array = fields->GetArray(i);
+    if (array) {
+      this->PointBytes += array->GetNumberOfComponents()*array->GetDataTypeSize();
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkZoltanBasePartitionFilter::ComputePartSizes()
+{
+  int P = this->UpdateNumPieces;
+  this->PartSizes.clear();
+  std::vector<double> capacity(P, 1.0);
+  if (!this->ProcessCapacities.empty()) {
+    for (int p=0; p<P && p<static_cast<int>(this->ProcessCapacities.size()); ++p) {
+      capacity[p] = this->ProcessCapacities[p];
+    }
+  }
+  else if (this->AutoCapacity) {
+    //
+    // memory and cores of the node are shared by the ranks on it, each rank
+    // gets the smaller of its two shares relative to the mean rank
+    //
+    vtksys::SystemInformation info;
+    info.RunCPUCheck();
+    info.RunMemoryCheck();
+    int ranksOnNode = static_cast<int>(std::count(this->NodeOfRank.begin(),
+      this->NodeOfRank.end(), this->NodeOfRank[this->UpdatePiece]));
+    double local[2] = {
+      static_cast<double>(info.GetHostMemoryTotal())/ranksOnNode,
+      static_cast<double>(info.GetNumberOfLogicalCPU())/ranksOnNode };
+    std::vector<double> all(2*P);
+    this->Controller->AllGather(local, &all[0], 2);
+    double mean[2] = { 0.0, 0.0 };
+    for (int p=0; p<P; ++p) {
+      mean[0] += all[2*p]/P;
+      mean[1] += all[2*p+1]/P;
+    }
+    for (int p=0; p<P; ++p) {
+      double memory = mean[0]>0.0 ? all[2*p]/mean[0] : 1.0;
+      double cores  = mean[1]>0.0 ? all[2*p+1]/mean[1] : 1.0;
+      capacity[p] = std::min(memory, cores);
+    }
+  }
+  double total = std::accumulate(capacity.begin(), capacity.end(), 0.0);
+  if (total<=0.0) {
+    vtkWarningMacro("All process capacities are 0, using equal shares");
+    return;
+  }
+  if (std::count(capacity.begin(), capacity.end(), capacity[0])==P) {
+    return;
+  }
+  const int K = this->PartsPerProcess;
+  this->PartSizes.resize(this->NumberOfParts);
+  for (int part=0; part<this->NumberOfParts; ++part) {
+    this->PartSizes[part] = capacity[part/K]/(total*K);
+  }
+  vtkDebugMacro("Capacity of this process " << capacity[this->UpdatePiece]/total);
+}
+
+//----------------------------------------------------------------------------
+double vtkZoltanBasePartitionFilter::GetPartSizeFraction(int part0, int part1)
+{
+  if (this->PartSizes.empty()) {
+    return static_cast<double>(part1-part0)/this->NumberOfParts;
+  }
+  return std::accumulate(this->PartSizes.begin()+part0, this->PartSizes.begin()+part1, 0.0);
+}
+
+//----------------------------------------------------------------------------
+int vtkZoltanBasePartitionFilter::GetLowerPartCount(int part0, int part1)
+{
+  int nlower = (part1-part0)/2;
+  const int K = this->PartsPerProcess;
+  int proc0 = part0/K, proc1 = (part1-1)/K;
+  bool acrossNodes = this->UseNodeHierarchy && this->NodeRanksContiguous &&
+    this->NodeOfRank[proc0]!=this->NodeOfRank[proc1];
+  if (!acrossNodes && (K==1 || proc0==proc1)) {
+    return nlower;
+  }
+  // the range spans several nodes/processes, cut between them nearest the middle
+  int best = -1;
+  for (int p=part0+1; p<part1; ++p) {
+    bool boundary = acrossNodes ?
+      (this->NodeOfRank[p/K]!=this->NodeOfRank[(p-1)/K]) : (p%K==0);
+    if (boundary &&
+        (best<0 || std::abs(2*(p-part0)-(part1-part0)) < std::abs(2*(best-part0)-(part1-part0))))
+    {
+      best = p;
+    }
+  }
+  return best-part0;
+}
+
+//----------------------------------------------------------------------------
+void vtkZoltanBasePartitionFilter::GroupPieceBoundingBoxes()
+{
+  //
+  // the boxes computed so far are those of the parts
+  //
+  this->PieceBoxList = this->BoxList;
+  this->PieceExtentTranslator->SetNumberOfPieces(static_cast<int>(this->PieceBoxList.size()));
+  for (size_t p=0; p<this->PieceBoxList.size(); p++) {
+    double bounds[6];
+    this->PieceBoxList[p].GetBounds(bounds);
+    this->PieceExtentTranslator->SetBoundsForPiece(static_cast<int>(p), bounds);
+  }
+  this->PieceExtentTranslator->InitWholeBounds();
+  if (this->PartsPerProcess==1) {
+    return;
+  }
+
+  //
+  // a process holds the union of its pieces
+  //
+  this->BoxList.assign(this->UpdateNumPieces, vtkBoundingBox());
+  for (size_t p=0; p<this->PieceBoxList.size(); p++) {
+    if (this->PieceBoxList[p].IsValid()) {
+      this->BoxList[this->GetProcessOfPiece(static_cast<int>(p))].AddBox(this->PieceBoxList[p]);
+    }
+  }
+  this->ExtentTranslator->SetNumberOfPieces(this->UpdateNumPieces);
+  for (int p=0; p<this->UpdateNumPieces; p++) {
+    double bounds[6];
+    this->BoxList[p].GetBounds(bounds);
+    this->ExtentTranslator->SetBoundsForPiece(p, bounds);
+  }
+  this->ExtentTranslator->InitWholeBounds();
+}
+
+//----------------------------------------------------------------------------
+void vtkZoltanBasePartitionFilter::ExtractPieces(vtkPointSet *output, vtkMultiBlockDataSet *pieces)
+{
+  if (!pieces) {
+    return;
+  }
+  const int K = this->PartsPerProcess;
+  vtkIntArray *partIds = vtkIntArray::SafeDownCast(output->GetPointData()->GetArray("vtkPartitionId"));
+  pieces->SetNumberOfBlocks(K);
+  if (K==1 || !partIds) {
+    vtkSmartPointer<vtkPointSet> piece;
+    piece.TakeReference(output->NewInstance());
+    piece->ShallowCopy(output);
+    pieces->SetBlock(0, piece);
+    return;
+  }
+
+  //
+  // a cell belongs to the piece of its first point held here, cells using
+  // only points of other processes (ghosts) go to the first local piece
+  //
+  const int first = this->UpdatePiece*K;
+  vtkIdType N = output->GetNumberOfPoints();
+  vtkIdType C = output->GetNumberOfCells();
+  std::vector<int> cellPiece(C, 0);
+  vtkSmartPointer<vtkIdList> ptIds = vtkSmartPointer<vtkIdList>::New();
+  for (vtkIdType c=0; c<C; ++c) {
+    output->GetCellPoints(c, ptIds);
+    for (vtkIdType j=0; j<ptIds->GetNumberOfIds(); ++j) {
+      int k = partIds->GetValue(ptIds->GetId(j)) - first;
+      if (k>=0 && k<K) {
+        cellPiece[c] = k;
+        break;
+      }
+    }
+  }
+
+  vtkPolyData         *polys = vtkPolyData::SafeDownCast(output);
+  vtkUnstructuredGrid *grid  = vtkUnstructuredGrid::SafeDownCast(output);
+  std::vector<vtkIdType> pointMap(N);
+  vtkSmartPointer<vtkIdList> newIds = vtkSmartPointer<vtkIdList>::New();
+  for (int k=0; k<K; ++k) {
+    vtkSmartPointer<vtkPointSet> piece;
+    piece.TakeReference(output->NewInstance());
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    points->SetDataType(output->GetPoints() ? output->GetPoints()->GetDataType() : VTK_FLOAT);
+    piece->SetPoints(points);
+    piece->GetPointData()->CopyAllocate(output->GetPointData());
+    piece->GetCellData()->CopyAllocate(output->GetCellData());
+    if (polys) {
+      vtkPolyData::SafeDownCast(piece)->Allocate();
+    }
+    else if (grid) {
+      vtkUnstructuredGrid::SafeDownCast(piece)->Allocate();
+    }
+    //
+    // points of the piece first, then those used by its cells
+    //
+    std::fill(pointMap.begin(), pointMap.end(), -1);
+    for (vtkIdType i=0; i<N; ++i) {
+      if (partIds->GetValue(i)-first==k) {
+        pointMap[i] = points->InsertNextPoint(output->GetPoint(i));
+        piece->GetPointData()->CopyData(output->GetPointData(), i, pointMap[i]);
+      }
+    }
+    for (vtkIdType c=0; c<C; ++c) {
+      if (cellPiece[c]!=k) {
+        continue;
+      }
+      output->GetCellPoints(c, ptIds);
+      newIds->SetNumberOfIds(ptIds->GetNumberOfIds());
+      for (vtkIdType j=0; j<ptIds->GetNumberOfIds(); ++j) {
+        vtkIdType id = ptIds->GetId(j);
+        if (pointMap[id]<0) {
+          pointMap[id] = points->InsertNextPoint(output->GetPoint(id));
+          piece->GetPointData()->CopyData(output->GetPointData(), id, pointMap[id]);
+        }
+        newIds->SetId(j, pointMap[id]);
+      }
+      vtkIdType newCell = -1;
+      if (polys) {
+        newCell = vtkPolyData::SafeDownCast(piece)->InsertNextCell(output->GetCellType(c), newIds);
+      }
+      else if (grid) {
+        newCell = vtkUnstructuredGrid::SafeDownCast(piece)->InsertNextCell(output->GetCellType(c), newIds);
+      }
+      if (newCell>=0) {
+        piece->GetCellData()->CopyData(output->GetCellData(), c, newCell);
+      }
+    }
+    piece->Squeeze();
+    pieces->SetBlock(k, piece);
+    std::stringstream name;
+    name << "Piece " << first+k;
+    pieces->GetMetaData(k)->Set(vtkCompositeDataSet::NAME(), name.str().c_str());
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkZoltanBasePartitionFilter::IsAlreadyBalanced(vtkIdType numPoints, vtkBoundingBox &globalBounds)
+{
+  if (this->ImbalanceThreshold<=0.0 || this->PartsPerProcess>1) {
+    this->SkippingPartition = false;
+    return false;
+  }
+  // with empty export lists this is the imbalance of the current distribution,
+  // every process gets the same result so all of them take the same path
+  this->ComputeCriterionImbalance(numPoints);
+  double most = *std::max_element(this->CriterionImbalance.begin(), this->CriterionImbalance.end());
+  //
+  // hysteresis : once a partition was needed, skipping resumes only when the
+  // imbalance is back within the (lower) BalancedThreshold
+  //
+  double threshold = this->ImbalanceThreshold;
+  if (!this->SkippingPartition && this->BalancedThreshold>0.0) {
+    threshold = std::min(this->BalancedThreshold, this->ImbalanceThreshold);
+  }
+  bool balanced = (most<=threshold);
+  vtkDebugMacro("Current imbalance " << most << " threshold " << threshold);
+  //
+  // the boxes are then the bounds of the points of each process, they must
+  // not overlap or the halo regions (and ghost points) would cover the data
+  // of other processes, such a distribution is partitioned
+  //
+  if (balanced) {
+    this->ComputePartitionBoundingBoxes(globalBounds);
+    for (int p=0; balanced && p<this->NumberOfParts; ++p) {
+      for (int q=p+1; balanced && q<this->NumberOfParts; ++q) {
+        vtkBoundingBox &a = this->BoxList[p], &b = this->BoxList[q];
+        if (!a.IsValid() || !b.IsValid()) {
+          continue;
+        }
+        bool overlap = true;
+        for (int i=0; i<3; ++i) {
+          overlap = overlap && (a.GetMinPoint()[i]<b.GetMaxPoint()[i]) && (b.GetMinPoint()[i]<a.GetMaxPoint()[i]);
+        }
+        balanced = !overlap;
+      }
+    }
+    vtkDebugMacro("Process bounds " << (balanced ? "disjoint" : "overlap"));
+  }
+  this->SkippingPartition = balanced;
+  this->PartitionSkipped  = balanced;
+  return balanced;
+}
+
+//----------------------------------------------------------------------------
+void vtkZoltanBasePartitionFilter::ComputeCriterionImbalance(vtkIdType numPoints)
+{
+  int P   = this->UpdateNumPieces;
+  int dim = std::max(this->NumberOfWeightCriteria, 1);
+  //
+  // destination of each local point from the export lists
+  //
+  std::vector<int> parts(numPoints, this->UpdatePiece);
+  vtkIdType offset = this->ZoltanCallbackData.ProcessOffsetsPointId[this->ZoltanCallbackData.ProcessRank];
+  for (int i=0; i<this->LoadBalanceData.numExport; ++i) {
+    parts[this->LoadBalanceData.exportGlobalGids[i] - offset] = this->LoadBalanceData.exportProcs[i];
+  }
+  std::vector<double> local(P*dim, 0.0), global(P*dim, 0.0);
+  for (vtkIdType i=0; i<numPoints; ++i) {
+    for (int c=0; c<dim; ++c) {
+      const float *weights = this->GetCriterionWeights(c);
+      local[parts[i]*dim+c] += weights ? weights[i] : 1.0;
+    }
+  }
+  this->Controller->AllReduce(&local[0], &global[0], P*dim, vtkCommunicator::SUM_OP);
+  //
+  this->CriterionImbalance.assign(dim, 1.0);
+  for (int c=0; c<dim; ++c) {
+    double total = 0.0, most = 0.0;
+    for (int p=0; p<P; ++p) {
+      total += global[p*dim+c];
+    }
+    for (int p=0; p<P && total>0.0; ++p) {
+      // relative to the share of the process, an excluded one holding data
+      // is counted as if it had an equal share
+      double share = this->GetProcessTargetFraction(p);
+      most = std::max(most, global[p*dim+c]/(total*(share>0.0 ? share : 1.0/P)));
+    }
+    if (total>0.0) {
+      this->CriterionImbalance[c] = most;
+    }
+    vtkDebugMacro("Criterion " << c << " imbalance " << this->CriterionImbalance[c]);
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkZoltanBasePartitionFilter::SelectSamplePoints(vtkIdType numPoints)
+{
+  std::vector<vtkIdType> &samples = this->ZoltanCallbackData.SampleIds;
+  samples.clear();
+  this->NumberOfSamplePoints = 0;
+  //
+  // the same fraction is used on every process
+  //
+  vtkIdType total = this->ZoltanCallbackData.ProcessOffsetsPointId[this->UpdateNumPieces];
+  double fraction = this->SampleFraction;
+  if (this->SampleTargetCount>0 && total>0) {
+    fraction = static_cast<double>(this->SampleTargetCount)/total;
+  }
+  if (fraction<=0.0 || fraction>=1.0) {
+    return false;
+  }
+  //
+  // points are usually stored with some spatial coherence, taking one point at
+  // random from each run of Ids spreads the sample over the local domain
+  //
+  vtkIdType strata = 0;
+  if (numPoints>0) {
+    strata = std::min(numPoints, std::max(static_cast<vtkIdType>(1),
+      static_cast<vtkIdType>(std::ceil(numPoints*fraction))));
+  }
+  vtkNew<vtkMinimalStandardRandomSequence> random;
+  random->SetSeed(this->UpdatePiece+1);
+  samples.reserve(strata);
+  for (vtkIdType s=0; s<strata; ++s) {
+    vtkIdType first = static_cast<vtkIdType>(static_cast<double>(s)*numPoints/strata);
+    vtkIdType last  = static_cast<vtkIdType>(static_cast<double>(s+1)*numPoints/strata);
+    vtkIdType pick  = static_cast<vtkIdType>(random->GetValue()*(last-first));
+    samples.push_back(first + std::min(pick, last-first-1));
+    random->Next();
+  }
+  vtkIdType localCount = strata;
+  this->Controller->AllReduce(&localCount, &this->NumberOfSamplePoints, 1, vtkCommunicator::SUM_OP);
+  vtkDebugMacro("Sampling " << strata << " of " << numPoints << " points");
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkZoltanBasePartitionFilter::ComputeSampleImbalance(const std::vector<int> &sampleParts)
+{
+  int P = this->NumberOfParts;
+  const float *weights = this->GetCriterionWeights(0);
+  std::vector<double> local(P, 0.0), global(P, 0.0);
+  for (size_t j=0; j<sampleParts.size(); ++j) {
+    local[sampleParts[j]] += weights ? weights[this->ZoltanCallbackData.SampleIds[j]] : 1.0;
+  }
+  this->Controller->AllReduce(&local[0], &global[0], P, vtkCommunicator::SUM_OP);
+  double total = std::accumulate(global.begin(), global.end(), 0.0), most = 0.0;
+  for (int p=0; p<P && total>0.0; ++p) {
+    double share = this->GetPartSizeFraction(p, p+1);
+    most = std::max(most, global[p]/(total*(share>0.0 ? share : 1.0/P)));
+  }
+  this->SampleImbalance = total>0.0 ? most : 1.0;
+}
+
+//----------------------------------------------------------------------------
+void vtkZoltanBasePartitionFilter::ReleaseZoltanData()
+{
+  if (this->IncrementalPartitioning || !this->ZoltanData) {
+    return;
+  }
+  vtkDebugMacro("Zoltan_Destroy");
+  Zoltan_Destroy(&this->ZoltanData);
+  this->ZoltanData = NULL;
+}
+
 //----------------------------------------------------------------------------
 int vtkZoltanBasePartitionFilter::RequestData(vtkInformation* info,
                                  vtkInformationVector** inputVector,
@@ -967,28 +1925,38 @@ int vtkZoltanBasePartitionFilter::ZoltanPointMigrate(MigrationLists &migrationLi
   ZOLTAN_ID_TYPE *GlobalIdsPtr = migrationLists.known.GlobalIdsPtr ? migrationLists.known.GlobalIdsPtr : (migrationLists.known.GlobalIds.size()>0 ? &migrationLists.known.GlobalIds[0] : NULL);
   int            *ProcsPtr     = migrationLists.known.ProcsPtr     ? migrationLists.known.ProcsPtr     : (migrationLists.known.Procs.size()>0     ? &migrationLists.known.Procs[0]     : NULL);
 
+#ifdef VTK_USE_MPI
+  // the buffers of Zoltan_Migrate cannot be bounded, use our own transport
+  if (this->MigrationTransport!=vtkZoltanBasePartitionFilter::ZoltanTransport ||
+      this->MaxMigrationBufferBytes>0) {
+    return this->NativePointMigrate(migrationLists, keepinformation);
+  }
+#endif
+
   //
-  // Register functions for packing and unpacking data by migration tools.
+  // Register functions for packing and unpacking data by migration tools,
+  // the multi object versions handle all the points of an exchange per call
+  // (Zoltan_Migrate uses them in preference to the single object ones)
   //
   if (this->ZoltanCallbackData.PointType==VTK_FLOAT) {
-    zsize_fn  f1 = zoltan_obj_size_function_pointdata<float>;
-    zpack_fn  f2 = zoltan_pack_obj_function_pointdata<float>;
-    zupack_fn f3 = zoltan_unpack_obj_function_pointdata<float>;
-    zprem_fn  f4 = zoltan_pre_migrate_function_null;
-    Zoltan_Set_Fn(this->ZoltanData, ZOLTAN_OBJ_SIZE_FN_TYPE,       (void (*)()) f1, &this->ZoltanCallbackData);
-    Zoltan_Set_Fn(this->ZoltanData, ZOLTAN_PACK_OBJ_FN_TYPE,       (void (*)()) f2, &this->ZoltanCallbackData);
-    Zoltan_Set_Fn(this->ZoltanData, ZOLTAN_UNPACK_OBJ_FN_TYPE,     (void (*)()) f3, &this->ZoltanCallbackData);
-    Zoltan_Set_Fn(this->ZoltanData, ZOLTAN_PRE_MIGRATE_PP_FN_TYPE, (void (*)()) f4, &this->ZoltanCallbackData);
+    zsizem_fn  f1 = zoltan_obj_size_multi_function_pointdata<float>;
+    zpackm_fn  f2 = zoltan_pack_obj_multi_function_pointdata<float>;
+    zupackm_fn f3 = zoltan_unpack_obj_multi_function_pointdata<float>;
+    zprem_fn   f4 = zoltan_pre_migrate_function_null;
+    Zoltan_Set_Fn(this->ZoltanData, ZOLTAN_OBJ_SIZE_MULTI_FN_TYPE,   (void (*)()) f1, &this->ZoltanCallbackData);
+    Zoltan_Set_Fn(this->ZoltanData, ZOLTAN_PACK_OBJ_MULTI_FN_TYPE,   (void (*)()) f2, &this->ZoltanCallbackData);
+    Zoltan_Set_Fn(this->ZoltanData, ZOLTAN_UNPACK_OBJ_MULTI_FN_TYPE, (void (*)()) f3, &this->ZoltanCallbackData);
+    Zoltan_Set_Fn(this->ZoltanData, ZOLTAN_PRE_MIGRATE_PP_FN_TYPE,   (void (*)()) f4, &this->ZoltanCallbackData);
   }
   else if (this->ZoltanCallbackData.PointType==VTK_DOUBLE) {
-    zsize_fn  f1 = zoltan_obj_size_function_pointdata<double>;
-    zpack_fn  f2 = zoltan_pack_obj_function_pointdata<double>;
-    zupack_fn f3 = zoltan_unpack_obj_function_pointdata<double>;
-    zprem_fn  f4 = zoltan_pre_migrate_function_null;
-    Zoltan_Set_Fn(this->ZoltanData, ZOLTAN_OBJ_SIZE_FN_TYPE,       (void (*)()) f1, &this->ZoltanCallbackData);
-    Zoltan_Set_Fn(this->ZoltanData, ZOLTAN_PACK_OBJ_FN_TYPE,       (void (*)()) f2, &this->ZoltanCallbackData);
-    Zoltan_Set_Fn(this->ZoltanData, ZOLTAN_UNPACK_OBJ_FN_TYPE,     (void (*)()) f3, &this->ZoltanCallbackData);
-    Zoltan_Set_Fn(this->ZoltanData, ZOLTAN_PRE_MIGRATE_PP_FN_TYPE, (void (*)()) f4, &this->ZoltanCallbackData);
+    zsizem_fn  f1 = zoltan_obj_size_multi_function_pointdata<double>;
+    zpackm_fn  f2 = zoltan_pack_obj_multi_function_pointdata<double>;
+    zupackm_fn f3 = zoltan_unpack_obj_multi_function_pointdata<double>;
+    zprem_fn   f4 = zoltan_pre_migrate_function_null;
+    Zoltan_Set_Fn(this->ZoltanData, ZOLTAN_OBJ_SIZE_MULTI_FN_TYPE,   (void (*)()) f1, &this->ZoltanCallbackData);
+    Zoltan_Set_Fn(this->ZoltanData, ZOLTAN_PACK_OBJ_MULTI_FN_TYPE,   (void (*)()) f2, &this->ZoltanCallbackData);
+    Zoltan_Set_Fn(this->ZoltanData, ZOLTAN_UNPACK_OBJ_MULTI_FN_TYPE, (void (*)()) f3, &this->ZoltanCallbackData);
+    Zoltan_Set_Fn(this->ZoltanData, ZOLTAN_PRE_MIGRATE_PP_FN_TYPE,   (void (*)()) f4, &this->ZoltanCallbackData);
   }
 
   CLEAR_ZOLTAN_DEBUG
@@ -1021,6 +1989,11 @@ int vtkZoltanBasePartitionFilter::ZoltanPointMigrate(MigrationLists &migrationLi
 
   int number_found = migrationLists.num_found;
 
+  // Zoltan_Migrate holds a send and a receive buffer for the points
+  vtkIdType pointBytes = this->ZoltanCallbackData.TotalSizePerId +
+    3*vtkDataArray::GetDataTypeSize(this->ZoltanCallbackData.PointType);
+  this->UpdatePeakMigrationBuffer(pointBytes*(num_known+std::max(number_found, 0)));
+
   //
   // Release the arrays allocated during Zoltan_Invert_Lists
   //
@@ -1036,6 +2009,368 @@ int vtkZoltanBasePartitionFilter::ZoltanPointMigrate(MigrationLists &migrationLi
   return number_found;
 }
 
+#ifdef VTK_USE_MPI
+//----------------------------------------------------------------------------
+// Exchange one field, tuples of 'size' bytes, sent/received in rank order.
+// The sparse exchange posts messages only to/from the processes which have
+// something to send/receive instead of a collective over all processes.
+// When requests is given the exchange is only started and its requests are
+// appended, the buffers must be left untouched until they complete.
+//----------------------------------------------------------------------------
+#define PARTITION_MIGRATE_TAG 2741
+
+static void ExchangeTuples(int size, const char *sendbuf,
+  const std::vector<int> &sendCounts, const std::vector<int> &sendDispls,
+  char *recvbuf, const std::vector<int> &recvCounts, const std::vector<int> &recvDispls,
+  MPI_Datatype tuple, bool sparse, MPI_Comm comm, std::vector<MPI_Request> *requests)
+{
+  int P = static_cast<int>(sendCounts.size());
+  if (!sparse) {
+#if MPI_VERSION>=3
+    if (requests) {
+      requests->push_back(MPI_REQUEST_NULL);
+      MPI_Ialltoallv(const_cast<char*>(sendbuf), const_cast<int*>(&sendCounts[0]),
+        const_cast<int*>(&sendDispls[0]), tuple,
+        recvbuf, const_cast<int*>(&recvCounts[0]), const_cast<int*>(&recvDispls[0]), tuple,
+        comm, &requests->back());
+      return;
+    }
+#endif
+    // before MPI 3 there is no non blocking collective, the exchange completes here
+    MPI_Alltoallv(const_cast<char*>(sendbuf), const_cast<int*>(&sendCounts[0]),
+      const_cast<int*>(&sendDispls[0]), tuple,
+      recvbuf, const_cast<int*>(&recvCounts[0]), const_cast<int*>(&recvDispls[0]), tuple, comm);
+    return;
+  }
+  std::vector<MPI_Request> local;
+  std::vector<MPI_Request> &pending = requests ? *requests : local;
+  size_t start = pending.size();
+  pending.reserve(start + 2*P);
+  for (int p=0; p<P; ++p) {
+    if (recvCounts[p]>0) {
+      pending.push_back(MPI_REQUEST_NULL);
+      MPI_Irecv(recvbuf + static_cast<vtkIdType>(size)*recvDispls[p], recvCounts[p], tuple,
+        p, PARTITION_MIGRATE_TAG, comm, &pending.back());
+    }
+  }
+  for (int p=0; p<P; ++p) {
+    if (sendCounts[p]>0) {
+      pending.push_back(MPI_REQUEST_NULL);
+      MPI_Isend(const_cast<char*>(sendbuf) + static_cast<vtkIdType>(size)*sendDispls[p], sendCounts[p], tuple,
+        p, PARTITION_MIGRATE_TAG, comm, &pending.back());
+    }
+  }
+  if (!requests && !local.empty()) {
+    MPI_Waitall(static_cast<int>(local.size()), &local[0], MPI_STATUSES_IGNORE);
+  }
+}
+
+//----------------------------------------------------------------------------
+// Exchange all the fields without any buffer : for each process one derived
+// datatype gathers the tuples sent from the input arrays (at the byte offset
+// of each local Id) and another one places the tuples received at their
+// final position in each output array, the global Ids being the last member
+// of both.
+//----------------------------------------------------------------------------
+static void ExchangeWithDatatypes(
+  const std::vector<const char*> &inFields, const std::vector<char*> &outFields,
+  const std::vector<int> &fieldSizes, const std::vector<vtkIdType> &sendLocal,
+  std::vector<ZOLTAN_ID_TYPE> &sendIds, std::vector<ZOLTAN_ID_TYPE> &recvIds, vtkIdType first,
+  const std::vector<int> &sendCounts, const std::vector<int> &sendDispls,
+  const std::vector<int> &recvCounts, const std::vector<int> &recvDispls,
+  bool sparse, MPI_Comm comm)
+{
+  int P = static_cast<int>(sendCounts.size());
+  int F = static_cast<int>(fieldSizes.size());
+  std::vector<MPI_Datatype> tuples(F);
+  for (int f=0; f<F; ++f) {
+    MPI_Type_contiguous(fieldSizes[f], MPI_BYTE, &tuples[f]);
+  }
+  //
+  std::vector<MPI_Datatype> sendTypes(P, MPI_BYTE), recvTypes(P, MPI_BYTE);
+  std::vector<int>          sendOnes(P, 0), recvOnes(P, 0), zeros(P, 0);
+  std::vector<int>          blocks(F+1, 1);
+  std::vector<MPI_Aint>     addresses(F+1);
+  std::vector<MPI_Aint>     offsets;
+  std::vector<int>          ones;
+  std::vector<MPI_Datatype> members(F+1);
+  for (int p=0; p<P; ++p) {
+    if (sendCounts[p]>0) {
+      offsets.resize(sendCounts[p]);
+      ones.resize(sendCounts[p], 1);
+      for (int f=0; f<F; ++f) {
+        // byte offsets, the local Ids (vtkIdType) may not fit in an int element index
+        for (int j=0; j<sendCounts[p]; ++j) {
+          offsets[j] = static_cast<MPI_Aint>(sendLocal[sendDispls[p]+j])*fieldSizes[f];
+        }
+        MPI_Type_create_hindexed(sendCounts[p], &ones[0], &offsets[0], tuples[f], &members[f]);
+        MPI_Get_address(const_cast<char*>(inFields[f]), &addresses[f]);
+      }
+      MPI_Type_contiguous(sendCounts[p], ZOLTAN_ID_MPI_TYPE, &members[F]);
+      MPI_Get_address(&sendIds[sendDispls[p]], &addresses[F]);
+      MPI_Type_create_struct(F+1, &blocks[0], &addresses[0], &members[0], &sendTypes[p]);
+      MPI_Type_commit(&sendTypes[p]);
+      for (int f=0; f<=F; ++f) {
+        MPI_Type_free(&members[f]);
+      }
+      sendOnes[p] = 1;
+    }
+    if (recvCounts[p]>0) {
+      for (int f=0; f<F; ++f) {
+        MPI_Type_contiguous(recvCounts[p], tuples[f], &members[f]);
+        MPI_Get_address(outFields[f] + static_cast<vtkIdType>(fieldSizes[f])*(first+recvDispls[p]), &addresses[f]);
+      }
+      MPI_Type_contiguous(recvCounts[p], ZOLTAN_ID_MPI_TYPE, &members[F]);
+      MPI_Get_address(&recvIds[recvDispls[p]], &addresses[F]);
+      MPI_Type_create_struct(F+1, &blocks[0], &addresses[0], &members[0], &recvTypes[p]);
+      MPI_Type_commit(&recvTypes[p]);
+      for (int f=0; f<=F; ++f) {
+        MPI_Type_free(&members[f]);
+      }
+      recvOnes[p] = 1;
+    }
+  }
+  //
+  if (!sparse) {
+    MPI_Alltoallw(MPI_BOTTOM, &sendOnes[0], &zeros[0], &sendTypes[0],
+      MPI_BOTTOM, &recvOnes[0], &zeros[0], &recvTypes[0], comm);
+  }
+  else {
+    std::vector<MPI_Request> requests;
+    requests.reserve(2*P);
+    for (int p=0; p<P; ++p) {
+      if (recvOnes[p]) {
+        requests.push_back(MPI_REQUEST_NULL);
+        MPI_Irecv(MPI_BOTTOM, 1, recvTypes[p], p, PARTITION_MIGRATE_TAG, comm, &requests.back());
+      }
+    }
+    for (int p=0; p<P; ++p) {
+      if (sendOnes[p]) {
+        requests.push_back(MPI_REQUEST_NULL);
+        MPI_Isend(MPI_BOTTOM, 1, sendTypes[p], p, PARTITION_MIGRATE_TAG, comm, &requests.back());
+      }
+    }
+    if (!requests.empty()) {
+      MPI_Waitall(static_cast<int>(requests.size()), &requests[0], MPI_STATUSES_IGNORE);
+    }
+  }
+  //
+  for (int p=0; p<P; ++p) {
+    if (sendOnes[p]) MPI_Type_free(&sendTypes[p]);
+    if (recvOnes[p]) MPI_Type_free(&recvTypes[p]);
+  }
+  for (int f=0; f<F; ++f) {
+    MPI_Type_free(&tuples[f]);
+  }
+}
+
+//----------------------------------------------------------------------------
+// Zoltan_Migrate packs every object separately, sorts the messages and asks
+// for the object sizes before exchanging. All points have the same size here
+// so we count the points for each destination, pack them field by field into
+// one buffer ordered by destination, and exchange each field with a single
+// MPI_Alltoallv whose receive buffer is the output array itself (points
+// from lower ranks first, after the OutPointCount points already present).
+// With DatatypeTransport nothing is packed, see ExchangeWithDatatypes.
+//----------------------------------------------------------------------------
+int vtkZoltanBasePartitionFilter::NativePointMigrate(MigrationLists &migrationLists, bool keepinformation)
+{
+  int num_known                = static_cast<int>(migrationLists.known.nIDs ? migrationLists.known.nIDs : migrationLists.known.GlobalIds.size());
+  ZOLTAN_ID_TYPE *GlobalIdsPtr = migrationLists.known.GlobalIdsPtr ? migrationLists.known.GlobalIdsPtr : (migrationLists.known.GlobalIds.size()>0 ? &migrationLists.known.GlobalIds[0] : NULL);
+  int            *ProcsPtr     = migrationLists.known.ProcsPtr     ? migrationLists.known.ProcsPtr     : (migrationLists.known.Procs.size()>0     ? &migrationLists.known.Procs[0]     : NULL);
+  int num_found                = migrationLists.num_found;
+  //
+  CallbackData *callbackdata = &this->ZoltanCallbackData;
+  int          P             = this->UpdateNumPieces;
+  vtkIdType    offset        = callbackdata->ProcessOffsetsPointId[callbackdata->ProcessRank];
+  vtkIdType    first         = callbackdata->OutPointCount;
+  MPI_Comm     comm          = this->GetMPIComm();
+
+  //
+  // number of points sent to/received from each process and where they start
+  //
+  std::vector<int> sendCounts(P, 0), recvCounts(P, 0), sendDispls(P, 0), recvDispls(P, 0);
+  for (int i=0; i<num_known; ++i) {
+    sendCounts[ProcsPtr[i]]++;
+  }
+  for (int i=0; i<num_found; ++i) {
+    recvCounts[migrationLists.found_procs[i]]++;
+  }
+  int partners = 0;
+  for (int p=1; p<P; ++p) {
+    sendDispls[p] = sendDispls[p-1] + sendCounts[p-1];
+    recvDispls[p] = recvDispls[p-1] + recvCounts[p-1];
+  }
+  for (int p=0; p<P; ++p) {
+    if (p!=callbackdata->ProcessRank && (sendCounts[p]>0 || recvCounts[p]>0)) {
+      partners++;
+    }
+  }
+  // use point to point messages when no process talks to more than
+  // SparseMigrationFraction of the others
+  int maxPartners = 0;
+  this->Controller->AllReduce(&partners, &maxPartners, 1, vtkCommunicator::MAX_OP);
+  bool sparse = (maxPartners < this->SparseMigrationFraction*P);
+  this->SparseMigrationUsed = sparse ? 1 : 0;
+
+  //
+  // local Ids of the points sent, grouped by destination in export list order
+  //
+  std::vector<ZOLTAN_ID_TYPE> sendIds(num_known>0 ? num_known : 1);
+  std::vector<vtkIdType>      sendLocal(num_known>0 ? num_known : 1);
+  std::vector<int>            next(sendDispls);
+  for (int i=0; i<num_known; ++i) {
+    int j = next[ProcsPtr[i]]++;
+    sendIds[j]   = GlobalIdsPtr[i];
+    sendLocal[j] = static_cast<vtkIdType>(GlobalIdsPtr[i]) - offset;
+  }
+
+  //
+  // the fields (and the coordinates last) of each point
+  //
+  std::vector<const char*> inFields(callbackdata->InputArrayPointers.begin(), callbackdata->InputArrayPointers.end());
+  std::vector<char*>       outFields;
+  for (int f=0; f<callbackdata->NumberOfFields; ++f) {
+    outFields.push_back(static_cast<char*>(callbackdata->OutputArrayPointers[f]));
+  }
+  std::vector<int> fieldSizes(callbackdata->MemoryPerTuple);
+  inFields.push_back(static_cast<const char*>(callbackdata->InputPointsData));
+  outFields.push_back(static_cast<char*>(callbackdata->OutputPointsData));
+  fieldSizes.push_back(3*vtkDataArray::GetDataTypeSize(callbackdata->PointType));
+
+  std::vector<ZOLTAN_ID_TYPE> recvIds(num_found>0 ? num_found : 1);
+  bool                        mapped = false;
+
+  //
+  // the points are sent in rounds of at most 'chunk' points per process so
+  // that the send buffer (the Ids then one section per field) stays within
+  // MaxMigrationBufferBytes, a single round when there is no limit. The
+  // Datatype transport has no buffer but MPI may stage the data of a round,
+  // so it is bounded the same way.
+  //
+  bool datatypes = (this->MigrationTransport==vtkZoltanBasePartitionFilter::DatatypeTransport);
+  bool pipelined = (this->MigrationTransport==vtkZoltanBasePartitionFilter::PipelinedTransport);
+  vtkIdType pointBytes = sizeof(ZOLTAN_ID_TYPE);
+  for (size_t f=0; f<fieldSizes.size(); ++f) {
+    pointBytes += fieldSizes[f];
+  }
+  vtkIdType chunk = std::max(num_known, 1);
+  if (this->MaxMigrationBufferBytes>0) {
+    chunk = std::max(static_cast<vtkIdType>(1), std::min(chunk, this->MaxMigrationBufferBytes/pointBytes));
+  }
+  int rounds = static_cast<int>((num_known + chunk - 1)/chunk);
+  int maxRounds = 0;
+  this->Controller->AllReduce(&rounds, &maxRounds, 1, vtkCommunicator::MAX_OP);
+  this->NumberOfMigrationRounds = std::max(this->NumberOfMigrationRounds, maxRounds);
+  vtkIdType roundBytes = std::min(chunk, static_cast<vtkIdType>(num_known))*pointBytes;
+  std::vector<char> sendBuffer(datatypes ? 1 : std::max(roundBytes, static_cast<vtkIdType>(1)));
+  //
+  std::vector<int> roundSend(P, 0), roundSendDispls(P, 0), roundRecv(recvCounts), roundRecvDispls(P, 0), recvDone(P, 0);
+  std::vector<MPI_Request> requests;
+  for (int r=0; r<maxRounds; ++r) {
+    vtkIdType lo = std::min(static_cast<vtkIdType>(r)*chunk, static_cast<vtkIdType>(num_known));
+    vtkIdType hi = std::min(lo+chunk, static_cast<vtkIdType>(num_known));
+    int n = static_cast<int>(hi-lo);
+    // part of each destination's points in this round, and where they go,
+    // datatypes index the send lists directly, the buffer starts at lo
+    for (int p=0; p<P; ++p) {
+      vtkIdType b0 = std::max(lo, static_cast<vtkIdType>(sendDispls[p]));
+      vtkIdType b1 = std::min(hi, static_cast<vtkIdType>(sendDispls[p]+sendCounts[p]));
+      roundSend[p]       = static_cast<int>(std::max(b1-b0, static_cast<vtkIdType>(0)));
+      roundSendDispls[p] = static_cast<int>(datatypes ? b0 : b0-lo);
+    }
+    if (maxRounds>1) {
+      MPI_Alltoall(&roundSend[0], 1, MPI_INT, &roundRecv[0], 1, MPI_INT, comm);
+    }
+    for (int p=0; p<P; ++p) {
+      roundRecvDispls[p] = recvDispls[p] + recvDone[p];
+      recvDone[p]       += roundRecv[p];
+    }
+    if (datatypes) {
+      //
+      // MPI reads each field from the input and writes it to the output
+      //
+      ExchangeWithDatatypes(inFields, outFields, fieldSizes, sendLocal, sendIds, recvIds, first,
+        roundSend, roundSendDispls, roundRecv, roundRecvDispls, sparse, comm);
+      continue;
+    }
+    //
+    // exchange the global Ids, then pack each field and send it straight
+    // into the output. When pipelined the exchanges are non blocking, so a
+    // field is packed while the previous ones are in transit.
+    //
+    requests.clear();
+    ZOLTAN_ID_TYPE *ids = reinterpret_cast<ZOLTAN_ID_TYPE*>(&sendBuffer[0]);
+    std::copy(sendIds.begin()+lo, sendIds.begin()+hi, ids);
+    ExchangeTuples(sizeof(ZOLTAN_ID_TYPE), reinterpret_cast<const char*>(ids),
+      roundSend, roundSendDispls, reinterpret_cast<char*>(&recvIds[0]), roundRecv, roundRecvDispls,
+      ZOLTAN_ID_MPI_TYPE, sparse, comm, pipelined ? &requests : NULL);
+    size_t idRequests = requests.size();
+    char *out = &sendBuffer[0] + sizeof(ZOLTAN_ID_TYPE)*n;
+    for (size_t f=0; f<fieldSizes.size(); ++f) {
+      int         size = fieldSizes[f];
+      const char *in   = inFields[f];
+      for (int i=0; i<n; ++i) {
+        memcpy(out + static_cast<vtkIdType>(size)*i, in + size*sendLocal[lo+i], size);
+      }
+      MPI_Datatype tuple;
+      MPI_Type_contiguous(size, MPI_BYTE, &tuple);
+      MPI_Type_commit(&tuple);
+      ExchangeTuples(size, out, roundSend, roundSendDispls,
+        outFields[f] + static_cast<vtkIdType>(size)*first, roundRecv, roundRecvDispls,
+        tuple, sparse, comm, pipelined ? &requests : NULL);
+      // freeing is deferred by MPI until pending exchanges using it complete
+      MPI_Type_free(&tuple);
+      out += static_cast<vtkIdType>(size)*n;
+    }
+    size_t done = 0;
+    if (r==maxRounds-1) {
+      // all the Ids are known once those of the last round have arrived,
+      // they are mapped while the fields of a pipelined exchange arrive
+      if (idRequests>0) {
+        MPI_Waitall(static_cast<int>(idRequests), &requests[0], MPI_STATUSES_IGNORE);
+      }
+      for (int i=0; i<num_found; ++i) {
+        add_Id_to_interval_map(callbackdata, recvIds[i], first+i);
+      }
+      mapped = true;
+      done   = idRequests;
+    }
+    // the buffer is reused by the next round
+    if (requests.size()>done) {
+      MPI_Waitall(static_cast<int>(requests.size()-done), &requests[done], MPI_STATUSES_IGNORE);
+    }
+  }
+  if (!mapped) {
+    for (int i=0; i<num_found; ++i) {
+      add_Id_to_interval_map(callbackdata, recvIds[i], first+i);
+    }
+  }
+  this->UpdatePeakMigrationBuffer(roundBytes);
+  callbackdata->OutPointCount += num_found;
+
+  vtkDebugMacro("NativePointMigrate "
+    << " sent : " << num_known
+    << " received : " << num_found
+    << " rounds : " << maxRounds
+    << " sparse : " << sparse);
+
+  //
+  // Release the arrays allocated during Zoltan_Invert_Lists
+  //
+  if (!keepinformation) {
+    Zoltan_LB_Free_Part(
+      &migrationLists.found_global_ids,
+      &migrationLists.found_local_ids,
+      &migrationLists.found_procs,
+      &migrationLists.found_to_part);
+    // set to zero so we know data has been deleted
+    migrationLists.num_found = -1;
+  }
+  return num_found;
+}
+#endif
+
 
 // Description:
 //   Initialize the cuts with arrays of information.  This type of
@@ -1055,7 +2390,20 @@ int vtkZoltanBasePartitionFilter::ZoltanPointMigrate(MigrationLists &migrationLi
 //----------------------------------------------------------------------------
 vtkSmartPointer<vtkPKdTree> vtkZoltanBasePartitionFilter::CreatePkdTree()
 {
-  vtkSmartPointer<vtkBSPCuts> cuts = vtkSmartPointer<vtkBSPCuts>::New();
+  // no cuts were computed when the partition was skipped
+  if (this->PartitionSkipped) {
+    this->KdTree = NULL;
+    return NULL;
+  }
+  // only RCB (which multi-jagged falls back to) gives us a tree of cuts,
+  // the hierarchical partition keeps one RCB structure per level
+  if ((this->PartitionMethod!=vtkZoltanBasePartitionFilter::RCB &&
+       this->PartitionMethod!=vtkZoltanBasePartitionFilter::MultiJagged) ||
+      this->UseZoltanHierarchy())
+  {
+    this->KdTree = NULL;
+    return NULL;
+  }
   //
   RCB_STRUCT *rcb = (RCB_STRUCT *) (this->ZoltanData->LB.Data_Structure);
   struct rcb_tree *treept = rcb->Tree_Ptr;
@@ -1066,7 +2414,7 @@ vtkSmartPointer<vtkPKdTree> vtkZoltanBasePartitionFilter::CreatePkdTree()
   }
 
   // Zoltan might have remapped the partitions from the default depth first ordering
-  std::vector<int> remapping(this->UpdateNumPieces, -1);
+  std::vector<int> remapping(this->NumberOfParts, -1);
   for (int i=0; i<this->ZoltanData->LB.Num_Global_Parts; i++) {
     if (this->ZoltanData->LB.Remap) {
       remapping[this->ZoltanData->LB.Remap[i]] = i;
@@ -1163,6 +2511,16 @@ vtkSmartPointer<vtkPKdTree> vtkZoltanBasePartitionFilter::CreatePkdTree()
     }
   };
 
+  return this->CreatePkdTreeFromCuts(cut_axis, cut_position, cut_lower, cut_upper,
+    this->ZoltanData->LB.Remap /* &remapping[0]*/);
+}
+
+//----------------------------------------------------------------------------
+vtkSmartPointer<vtkPKdTree> vtkZoltanBasePartitionFilter::CreatePkdTreeFromCuts(
+  std::vector<int> &cut_axis, std::vector<double> &cut_position,
+  std::vector<int> &cut_lower, std::vector<int> &cut_upper, int *remapping)
+{
+  vtkSmartPointer<vtkBSPCuts> cuts = vtkSmartPointer<vtkBSPCuts>::New();
   cuts->CreateCuts(
     this->ExtentTranslator->GetWholeBounds(),
     cut_axis.size(),
@@ -1172,15 +2530,61 @@ vtkSmartPointer<vtkPKdTree> vtkZoltanBasePartitionFilter::CreatePkdTree()
     &cut_upper[0],
     NULL,NULL,NULL);
 
+  // with several pieces per process the regions are the pieces,
+  // each one belongs to the process holding it
+  std::vector<int> pieceProcess;
+  if (this->PartsPerProcess>1) {
+    pieceProcess.resize(this->NumberOfParts);
+    for (int r=0; r<this->NumberOfParts; r++) {
+      pieceProcess[r] = this->GetProcessOfPiece(r);
+    }
+    remapping = &pieceProcess[0];
+  }
+
   this->KdTree = vtkSmartPointer<vtkPKdTree2>::New();
   this->KdTree->SetController(this->Controller);
   this->KdTree->SetCuts(cuts);
   vtkPKdTree2::SafeDownCast(this->KdTree)->BuildLocator(
-    this->ExtentTranslator->GetWholeBounds(), this->ZoltanData->LB.Remap /* &remapping[0]*/, this->UpdateNumPieces);
+    this->ExtentTranslator->GetWholeBounds(), remapping, this->NumberOfParts);
 
   return KdTree;
 }
 
+//----------------------------------------------------------------------------
+void vtkZoltanBasePartitionFilter::SetExportListsFromParts(const std::vector<int> &parts)
+{
+  //
+  // export lists in local Id order, same as Zoltan returns them
+  //
+  // with several parts per process, parts are mapped to their process and
+  // kept for the vtkPartitionId array
+  //
+  vtkIdType offset = this->ZoltanCallbackData.ProcessOffsetsPointId[this->ZoltanCallbackData.ProcessRank];
+  this->ExportGlobalIds.clear();
+  this->ExportProcs.clear();
+  this->ExportParts.clear();
+  for (vtkIdType i=0; i<static_cast<vtkIdType>(parts.size()); ++i) {
+    int proc = this->GetProcessOfPiece(parts[i]);
+    if (proc!=this->UpdatePiece) {
+      this->ExportGlobalIds.push_back(static_cast<ZOLTAN_ID_TYPE>(i + offset));
+      this->ExportProcs.push_back(proc);
+      this->ExportParts.push_back(parts[i]);
+    }
+  }
+  if (this->PartsPerProcess>1) {
+    this->PointParts = parts;
+  }
+  this->LoadBalanceData.changes          = 1;
+  this->LoadBalanceData.numGidEntries    = 1;
+  this->LoadBalanceData.numLidEntries    = 0;
+  this->LoadBalanceData.numImport        = 0;
+  this->LoadBalanceData.numExport        = static_cast<int>(this->ExportGlobalIds.size());
+  this->LoadBalanceData.exportGlobalGids = this->ExportGlobalIds.empty() ? NULL : &this->ExportGlobalIds[0];
+  this->LoadBalanceData.exportProcs      = this->ExportProcs.empty() ? NULL : &this->ExportProcs[0];
+  this->LoadBalanceData.exportToPart     = this->ExportParts.empty() ? NULL : &this->ExportParts[0];
+  this->LoadBalanceData.exportLocalGids  = NULL;
+}
+
 
 //----------------------------------------------------------------------------
 //----------------------------------------------------------------------------
@@ -1270,6 +2674,7 @@ bool vtkZoltanBasePartitionFilter::MigratePointData(vtkDataSetAttributes *inPoin
   Zoltan_Set_Fn(this->ZoltanData, ZOLTAN_PACK_OBJ_FN_TYPE,       (void (*)()) f2, &this->ZoltanCallbackData);
   Zoltan_Set_Fn(this->ZoltanData, ZOLTAN_UNPACK_OBJ_FN_TYPE,     (void (*)()) f3, &this->ZoltanCallbackData);
   Zoltan_Set_Fn(this->ZoltanData, ZOLTAN_PRE_MIGRATE_PP_FN_TYPE, (void (*)()) f4, &this->ZoltanCallbackData);
+  ClearMultiMigrateFunctions(this->ZoltanData);
 
   int N1 = this->ZoltanCallbackData.OutPointCount;
   // this sets internal flags used by CopyData to ensure arrays are marked for copying
@@ -1310,6 +2715,8 @@ bool vtkZoltanBasePartitionFilter::MigratePointData(vtkDataSetAttributes *inPoin
   // Now let zoltan perform the send/receive exchange of data between processes
   //
   int num_known = this->MigrateLists.known.GlobalIds.size();
+  this->UpdatePeakMigrationBuffer(
+    this->ZoltanCallbackData.TotalSizePerId*(num_known+this->MigrateLists.num_found), "MigratePointData");
   int zoltan_error = Zoltan_Migrate (this->ZoltanData,
     this->MigrateLists.num_found,
     this->MigrateLists.found_global_ids,
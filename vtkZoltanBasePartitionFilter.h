@@ -86,6 +86,8 @@ class  vtkCellArray;
 class  vtkTimerLog;
 class  vtkFieldData;
 class  vtkPKdTree;
+class  vtkDataArray;
+class  vtkMultiBlockDataSet;
 // our special extent translator
 class  vtkBoundsExtentTranslator;
 class vtkInformationDataObjectMetaDataKey;
@@ -113,6 +115,9 @@ typedef int  (*zsize_fn) (void *, int , int , ZOLTAN_ID_PTR , ZOLTAN_ID_PTR , in
 typedef void (*zpack_fn) (void *, int , int , ZOLTAN_ID_PTR , ZOLTAN_ID_PTR , int , int , char *, int *);
 typedef void (*zupack_fn)(void *, int , ZOLTAN_ID_PTR , int , char *, int *);
 typedef void (*zprem_fn) (void *, int , int , int , ZOLTAN_ID_PTR , ZOLTAN_ID_PTR , int *, int *, int , ZOLTAN_ID_PTR , ZOLTAN_ID_PTR , int *, int *, int *);
+typedef void (*zsizem_fn)(void *, int , int , int , ZOLTAN_ID_PTR , ZOLTAN_ID_PTR , int *, int *);
+typedef void (*zpackm_fn)(void *, int , int , int , ZOLTAN_ID_PTR , ZOLTAN_ID_PTR , int *, int *, int *, char *, int *);
+typedef void (*zupackm_fn)(void *, int , int , ZOLTAN_ID_PTR , int *, int *, char *, int *);
 
 // Zoltan 2 typedefs
 typedef int localId_t;
@@ -167,6 +172,28 @@ class VTK_EXPORT vtkZoltanBasePartitionFilter : public vtkDataSetAlgorithm
     vtkSetStringMacro(PointWeightsArrayName);
     vtkGetStringMacro(PointWeightsArrayName);
 
+    // Description:
+    // Additional point weight arrays for multi-criteria load balancing.
+    // PointWeightsArrayName (if set) is the first criterion, arrays added here
+    // follow it. With more than one criterion every object has one weight per
+    // array (OBJ_WEIGHT_DIM>1) and all criteria are balanced together.
+    void AddPointWeightsArrayName(const char *name);
+    void ClearPointWeightsArrayNames();
+
+    // Description:
+    // Norm used to combine the criteria when several weight arrays are used,
+    // 1 = sum, 2 = euclidean, 3 = maximum (Zoltan RCB_MULTICRITERIA_NORM)
+    vtkSetClampMacro(MultiCriteriaNorm, int, 1, 3);
+    vtkGetMacro(MultiCriteriaNorm, int);
+
+    // Description:
+    // Number of weight criteria used by the last partition (0 when unweighted)
+    // and the imbalance (max part weight / average part weight) of each one.
+    // Without weights, criterion 0 is the point count.
+    // only valid after the filter has executed
+    int GetNumberOfWeightCriteria() { return this->NumberOfWeightCriteria; }
+    double GetCriterionImbalance(int criterion);
+
     // Description:
     // Return the Bounding Box for a partition
     // only valid after the filter has executed
@@ -195,6 +222,255 @@ class VTK_EXPORT vtkZoltanBasePartitionFilter : public vtkDataSetAlgorithm
     vtkSetMacro(GhostHaloSize, double);
     vtkGetMacro(GhostHaloSize, double);
 
+    // Geometric methods available for the load balance step
+    enum PartitionMethods {
+        RCB         = 0, // recursive coordinate bisection
+        RIB         = 1, // recursive inertial bisection
+        HSFC        = 2, // Hilbert space filling curve
+        MultiJagged = 3  // multi-jagged (Zoltan2 only, RCB is used with Zoltan)
+    };
+
+    // Description:
+    // Select the geometric method used to compute the partition.
+    // RCB and MultiJagged produce axis aligned boxes which tile the domain,
+    // for RIB and HSFC the partition bounding boxes are computed from the
+    // points assigned to each partition and may overlap.
+    vtkSetMacro(PartitionMethod, int);
+    vtkGetMacro(PartitionMethod, int);
+    // convenience setters for PartitionMethod
+    void SetPartitionMethodToRCB() { this->SetPartitionMethod(vtkZoltanBasePartitionFilter::RCB); }
+    void SetPartitionMethodToRIB() { this->SetPartitionMethod(vtkZoltanBasePartitionFilter::RIB); }
+    void SetPartitionMethodToHSFC() { this->SetPartitionMethod(vtkZoltanBasePartitionFilter::HSFC); }
+    void SetPartitionMethodToMultiJagged() { this->SetPartitionMethod(vtkZoltanBasePartitionFilter::MultiJagged); }
+
+    // Description:
+    // When partitioning a time series, the particles/cells usually move only a
+    // little between steps. Setting IncrementalPartitioning keeps the Zoltan
+    // structure (and the RCB cuts it holds) alive between executions so that
+    // the next partition is computed starting from the previous one, and only
+    // objects which crossed a cut are migrated.
+    vtkSetMacro(IncrementalPartitioning, int);
+    vtkGetMacro(IncrementalPartitioning, int);
+    vtkBooleanMacro(IncrementalPartitioning, int);
+
+    // Description:
+    // Return the number of objects (summed over all processes) that stayed on
+    // their process / were sent to another process during the last partition.
+    // only valid after the filter has executed
+    vtkGetMacro(NumberOfObjectsKept, vtkIdType);
+    vtkGetMacro(NumberOfObjectsMigrated, vtkIdType);
+
+    // Description:
+    // Partition across compute nodes first, then across the ranks of each node,
+    // so that partitions which are neighbours in space share a node and halo or
+    // migration traffic between them stays off the network. A node is the group
+    // of ranks sharing memory (MPI_Comm_split_type, with MPI 3 only, before
+    // that every rank is its own node). Has no effect when all the ranks are
+    // on one node or every node has a single rank.
+    vtkSetMacro(HierarchicalPartitioning, int);
+    vtkGetMacro(HierarchicalPartitioning, int);
+    vtkBooleanMacro(HierarchicalPartitioning, int);
+
+    // Description:
+    // When >0, nodes are groups of VirtualRanksPerNode consecutive ranks
+    // instead of the ranks sharing memory. Emulates a multi-node run on one
+    // node, for testing the hierarchical partition. 0 (default) finds the nodes.
+    void SetVirtualRanksPerNode(int ranks);
+    vtkGetMacro(VirtualRanksPerNode, int);
+
+    // Description:
+    // Number of compute nodes found, and the number of objects (summed over all
+    // processes) sent to a process on another node during the last partition.
+    // only valid after the filter has executed
+    vtkGetMacro(NumberOfNodes, int);
+    vtkGetMacro(NumberOfObjectsMigratedOffNode, vtkIdType);
+
+    // Description:
+    // Over-decomposition : the data is partitioned into PiecesPerProcess
+    // pieces per process, process p holding pieces [p*K, (p+1)*K).
+    // The piece of every output point is given by the "vtkPartitionId" point
+    // array and the pieces of this process are the blocks of a
+    // vtkMultiBlockDataSet on the second output port, whose extent translator
+    // holds the bounds of every piece. Ignored when running on a single process
+    // or when the input is already partitioned.
+    vtkSetClampMacro(PiecesPerProcess, int, 1, VTK_INT_MAX);
+    vtkGetMacro(PiecesPerProcess, int);
+
+    // Description:
+    // Return the Bounding Box of a piece and the process which holds it
+    // only valid after the filter has executed
+    vtkBoundingBox *GetPieceBoundingBox(int piece);
+    int GetProcessOfPiece(int piece) { return piece/this->PartsPerProcess; }
+    int GetNumberOfParts() { return this->NumberOfParts; }
+
+    // Description:
+    // The pieces of this process (second output)
+    vtkMultiBlockDataSet *GetPiecesOutput();
+
+    // Description:
+    // Sampling : the cuts are computed from a stratified random sample of the
+    // points and every point is then assigned to the part whose region holds
+    // it, so the cost of the partition depends on the sample size.
+    // SampleFraction is the fraction of the points used, SampleTargetCount
+    // (when >0) the number of sample points over all processes and overrides
+    // the fraction. 0 disables sampling, which is only done by the Zoltan (v1)
+    // and native RCB partitioners.
+    vtkSetClampMacro(SampleFraction, double, 0.0, 1.0);
+    vtkGetMacro(SampleFraction, double);
+    vtkSetClampMacro(SampleTargetCount, vtkIdType, 0, VTK_ID_MAX);
+    vtkGetMacro(SampleTargetCount, vtkIdType);
+
+    // Description:
+    // Number of sample points (over all processes) used by the last partition,
+    // 0 when it was not sampled, and the imbalance of the parts of the sample.
+    // The imbalance of all the points is given by GetCriterionImbalance.
+    // only valid after the filter has executed
+    vtkGetMacro(NumberOfSamplePoints, vtkIdType);
+    vtkGetMacro(SampleImbalance, double);
+
+    // Description:
+    // Heterogeneous processes : each process receives a share of the weight
+    // proportional to its capacity. Capacities are relative, AddProcessCapacity
+    // gives the capacity of the next rank (rank 0 first) and ranks without a
+    // value have capacity 1. A rank with capacity 0 receives no data at all.
+    // When no capacity is given and AutoCapacity is on, the capacity of a rank
+    // is the smaller of its share of the memory and of the cores of its node.
+    void AddProcessCapacity(double capacity);
+    void ClearProcessCapacities();
+    vtkSetMacro(AutoCapacity, int);
+    vtkGetMacro(AutoCapacity, int);
+    vtkBooleanMacro(AutoCapacity, int);
+
+    // Description:
+    // Fraction of the total weight targeted at a process by the last partition
+    // only valid after the filter has executed
+    double GetProcessTargetFraction(int rank);
+
+    // Description:
+    // Migration cost aware repartitioning, only effective when the mesh filter
+    // partitions the cell graph/hypergraph : Zoltan is given the size in bytes
+    // of every cell (ZOLTAN_OBJ_SIZE, fields, connectivity and points) and the
+    // partition is a repartition of the current distribution, where
+    // RepartitionMultiplier (PHG_REPART_MULTIPLIER) sets how much the bytes
+    // moved count against the edge cut. For points every object has the same
+    // size and the geometric methods ignore sizes, the parts are renumbered to
+    // keep the most points in place (REMAP) as they are by default.
+    vtkSetMacro(MigrationCostAware, int);
+    vtkGetMacro(MigrationCostAware, int);
+    vtkBooleanMacro(MigrationCostAware, int);
+    vtkSetClampMacro(RepartitionMultiplier, double, 0.0, VTK_DOUBLE_MAX);
+    vtkGetMacro(RepartitionMultiplier, double);
+
+    // Description:
+    // Bytes of point fields and coordinates (summed over all processes) sent
+    // to another process by the last partition
+    // only valid after the filter has executed
+    vtkGetMacro(NumberOfBytesMigrated, vtkIdType);
+
+    // Description:
+    // Skip the partition when the data is already balanced : the imbalance of
+    // the current distribution is measured with one reduction and, if no
+    // criterion exceeds ImbalanceThreshold (max over processes of weight /
+    // target weight, e.g. 1.1), nothing is partitioned or migrated and the
+    // boxes are the bounds of the points of each process. For a time series
+    // the data is then only repartitioned once its imbalance has drifted above
+    // the threshold. 0 (default) always partitions. When the bounds of two
+    // processes overlap the data is partitioned anyway, as their halos would
+    // hold the points of other processes. Not used with several pieces per
+    // process.
+    vtkSetClampMacro(ImbalanceThreshold, double, 0.0, VTK_DOUBLE_MAX);
+    vtkGetMacro(ImbalanceThreshold, double);
+
+    // Description:
+    // Hysteresis for ImbalanceThreshold : after an execution which had to
+    // partition (or the first one), the partition is only skipped again once
+    // the imbalance is within BalancedThreshold, lower than ImbalanceThreshold
+    // (e.g. 1.02). While skipping, ImbalanceThreshold applies. 0 (default)
+    // uses ImbalanceThreshold for both.
+    vtkSetClampMacro(BalancedThreshold, double, 0.0, VTK_DOUBLE_MAX);
+    vtkGetMacro(BalancedThreshold, double);
+
+    // Description:
+    // True when the last execution skipped the partition (see ImbalanceThreshold)
+    // only valid after the filter has executed
+    vtkGetMacro(PartitionSkipped, int);
+
+    // Transports available for the point migration
+    enum MigrationTransports {
+        ZoltanTransport    = 0, // Zoltan_Migrate with the pack/unpack callbacks
+        AlltoallvTransport = 1, // packed by destination and exchanged with MPI_Alltoallv
+        DatatypeTransport  = 2, // MPI derived datatypes, no send or receive buffer
+        PipelinedTransport = 3  // Alltoallv with one non blocking exchange per array
+    };
+
+    // Description:
+    // Select how points are migrated once the partition is known. Zoltan
+    // still computes the partition and the export/import lists, the
+    // Alltoallv transport then packs the points sent to each process into
+    // one contiguous buffer and every field is received directly into the
+    // output arrays. When each process exchanges with only a few others,
+    // point to point messages replace the MPI_Alltoallv (see
+    // SparseMigrationFraction). The Datatype transport packs nothing, MPI
+    // gathers the tuples sent to each process from the input arrays and
+    // writes those received into the output arrays using one derived
+    // datatype per process (MPI_Alltoallw). The Pipelined transport starts a
+    // non blocking exchange (MPI_Ialltoallv) for each array as soon as it is
+    // packed, so packing overlaps the transfers. Before MPI 3 the collective
+    // exchanges of the Pipelined transport are blocking, only point to point
+    // messages overlap.
+    // Cells (mesh filter) and MigratePointData always use Zoltan_Migrate.
+    vtkSetClampMacro(MigrationTransport, int, 0, 3);
+    vtkGetMacro(MigrationTransport, int);
+    void SetMigrationTransportToZoltan() { this->SetMigrationTransport(vtkZoltanBasePartitionFilter::ZoltanTransport); }
+    void SetMigrationTransportToAlltoallv() { this->SetMigrationTransport(vtkZoltanBasePartitionFilter::AlltoallvTransport); }
+    void SetMigrationTransportToDatatype() { this->SetMigrationTransport(vtkZoltanBasePartitionFilter::DatatypeTransport); }
+    void SetMigrationTransportToPipelined() { this->SetMigrationTransport(vtkZoltanBasePartitionFilter::PipelinedTransport); }
+
+    // Description:
+    // The native transports use point to point messages instead of a
+    // collective exchange when no process exchanges points with more than
+    // this fraction of the other processes. Default 0.25, 0 always uses the
+    // collective and 1 always uses point to point messages.
+    vtkSetClampMacro(SparseMigrationFraction, double, 0.0, 1.0);
+    vtkGetMacro(SparseMigrationFraction, double);
+
+    // Description:
+    // True when the last native point migration used point to point messages
+    // only valid after the filter has executed
+    vtkGetMacro(SparseMigrationUsed, int);
+
+    // Description:
+    // Limit (bytes per process) of the buffer used to send points, the
+    // exchange is split into as many rounds as needed to stay within it.
+    // The output arrays are sized from the import counts before the first
+    // round so received points are appended in place. 0 (default) sends
+    // everything at once. A limit selects the Alltoallv transport when the
+    // Zoltan one is set, as Zoltan_Migrate buffers cannot be bounded. The
+    // Datatype transport has no buffer but is split the same way, since MPI
+    // may stage the data of a round. The cells of the mesh filter are sent
+    // by Zoltan_Migrate in slices whose packed size stays within the limit,
+    // one Zoltan_Migrate per slice. MigratePointData still uses a single
+    // Zoltan_Migrate and is not bounded, a warning is given when its
+    // estimated buffers exceed the limit.
+    vtkSetClampMacro(MaxMigrationBufferBytes, vtkIdType, 0, VTK_ID_MAX);
+    vtkGetMacro(MaxMigrationBufferBytes, vtkIdType);
+
+    // Description:
+    // Largest migration buffer (in bytes) held by a process during the last
+    // execution. For the native transports and the cells sent in slices it
+    // is the send buffer of one round (for the Datatype transport the data of
+    // one round). For a single Zoltan_Migrate (Zoltan transport,
+    // MigratePointData) the send and receive buffers are estimated from the
+    // number of objects. The cells sent without a limit are not counted.
+    // only valid after the filter has executed
+    vtkGetMacro(PeakMigrationBufferBytes, vtkIdType);
+
+    // Description:
+    // Largest number of rounds used by a point or cell migration during the
+    // last execution, 1 unless MaxMigrationBufferBytes split the exchange
+    // only valid after the filter has executed
+    vtkGetMacro(NumberOfMigrationRounds, int);
+
 
     //----------------------------------------------------------------------------
     // Structure to hold all the dataset/mesh/points related data we pass to
@@ -231,6 +507,7 @@ class VTK_EXPORT vtkZoltanBasePartitionFilter : public vtkDataSetAlgorithm
       std::vector<int>              MemoryPerTuple;
       int                           TotalSizePerId;
       std::vector<vtkIdType>        LocalIdsToKeep;
+      std::vector<vtkIdType>        SampleIds;             // local Ids given to zoltan, all when empty
     } CallbackData;
 
     //----------------------------------------------------------------------------
@@ -295,6 +572,18 @@ class VTK_EXPORT vtkZoltanBasePartitionFilter : public vtkDataSetAlgorithm
     // Zoltan callback which returns the dimension of geometry (3D for us)
     static int get_num_geometry(void *data, int *ierr);
 
+    // Description:
+    // Zoltan HIER callbacks, level 0 partitions across nodes, level 1 across
+    // the ranks of a node, both with the geometric PartitionMethod
+    static int  get_hier_num_levels(void *data, int *ierr);
+    static int  get_hier_part(void *data, int level, int *ierr);
+    static void get_hier_method(void *data, int level, struct Zoltan_Struct *zz, int *ierr);
+
+    // Description:
+    // Remove the multi object migration callbacks, Zoltan_Migrate prefers them
+    // to single object callbacks so they must be cleared before using those
+    static void ClearMultiMigrateFunctions(struct Zoltan_Struct *zz);
+
     // Description:
     // Zoltan callback which returns coordinate geometry data (points)
     // templated here to alow float/double instances in our implementation
@@ -305,25 +594,28 @@ class VTK_EXPORT vtkZoltanBasePartitionFilter : public vtkDataSetAlgorithm
       int num_dim, double *geom_vec, int *ierr);
 
     // Description:
-    // A ZOLTAN_OBJ_SIZE_FN query function returns the size (in bytes) of the data buffer
-    // that is needed to pack all of a single object's data.
-    // Here we add up the size of all the field arrays for points + the geometry itself
+    // A ZOLTAN_OBJ_SIZE_MULTI_FN query function returns the size (in bytes) of the
+    // data buffer needed to pack each object, the size of all the field arrays
+    // for points + the geometry itself
     template<typename T>
-    static int zoltan_obj_size_function_pointdata(void *data,
-      int num_gid_entries, int num_lid_entries, ZOLTAN_ID_PTR global_id,
-      ZOLTAN_ID_PTR local_id, int *ierr);
+    static void zoltan_obj_size_multi_function_pointdata(void *data,
+      int num_gid_entries, int num_lid_entries, int num_ids,
+      ZOLTAN_ID_PTR global_ids, ZOLTAN_ID_PTR local_ids, int *sizes, int *ierr);
 
     // Description:
-    // Zoltan callback to pack all the data for one point into a buffer
+    // Zoltan callback to pack all the points sent by this process, array by array
     template<typename T>
-    static void zoltan_pack_obj_function_pointdata(void *data, int num_gid_entries, int num_lid_entries,
-      ZOLTAN_ID_PTR global_id, ZOLTAN_ID_PTR local_id, int dest, int size, char *buf, int *ierr);
+    static void zoltan_pack_obj_multi_function_pointdata(void *data,
+      int num_gid_entries, int num_lid_entries, int num_ids,
+      ZOLTAN_ID_PTR global_ids, ZOLTAN_ID_PTR local_ids, int *dest, int *sizes, int *idx,
+      char *buf, int *ierr);
 
     // Description:
-    // Zoltan callback to unpack all the data for one point from a buffer
+    // Zoltan callback to unpack all the points received by this process, array by array
     template<typename T>
-    static void zoltan_unpack_obj_function_pointdata(void *data, int num_gid_entries,
-      ZOLTAN_ID_PTR global_id, int size, char *buf, int *ierr);
+    static void zoltan_unpack_obj_multi_function_pointdata(void *data,
+      int num_gid_entries, int num_ids, ZOLTAN_ID_PTR global_ids, int *sizes, int *idx,
+      char *buf, int *ierr);
 
     // Description:
     // Zoltan callback for Pre migration setup/initialization
@@ -435,6 +727,12 @@ class VTK_EXPORT vtkZoltanBasePartitionFilter : public vtkDataSetAlgorithm
     // Override to specify different type of output
     virtual int FillOutputPortInformation(int port, vtkInformation* info);
 
+    // Description:
+    // The pieces output is a vtkMultiBlockDataSet, not a copy of the input type
+    virtual int RequestDataObject(vtkInformation*,
+                                  vtkInformationVector**,
+                                  vtkInformationVector*);
+
     // Description:
     virtual int RequestInformation(vtkInformation*,
                                    vtkInformationVector**,
@@ -460,11 +758,135 @@ class VTK_EXPORT vtkZoltanBasePartitionFilter : public vtkDataSetAlgorithm
     int ManualPointMigrate(MigrationLists &migrationLists, bool keepinformation);
     int ZoltanPointMigrate(MigrationLists &migrationLists, bool keepinformation);
 
-    vtkSmartPointer<vtkPKdTree> CreatePkdTree();
+    // Description:
+    // Migrate the points of the inverted lists with MPI directly, used in
+    // place of Zoltan_Migrate when MigrationTransport is not ZoltanTransport
+    int NativePointMigrate(MigrationLists &migrationLists, bool keepinformation);
+
+    // Description:
+    // Build the KdTree from the partition cuts, the default implementation
+    // reads the cuts from the Zoltan RCB structure
+    virtual vtkSmartPointer<vtkPKdTree> CreatePkdTree();
+
+    // Description:
+    // Create the KdTree from a list of cuts in vtkBSPCuts form, leaf nodes
+    // have lower=-regionId and upper=-1, remapping maps regions to processes
+    vtkSmartPointer<vtkPKdTree> CreatePkdTreeFromCuts(
+      std::vector<int> &cut_axis, std::vector<double> &cut_position,
+      std::vector<int> &cut_lower, std::vector<int> &cut_upper, int *remapping);
+
+    // Description:
+    // Partitioners which compute the load balance themselves give the
+    // destination of each local point, export lists are built from them
+    void SetExportListsFromParts(const std::vector<int> &parts);
 
     void AddHaloToBoundingBoxes(double GhostCellOverlap);
+
+    // Description:
+    // Find the weights arrays (any numeric type) and set one float pointer
+    // per criterion. Float arrays are used in place, others are converted
+    // once, Zoltan and the native partitioners take float weights.
     void SetupPointWeights(vtkDataSetAttributes *fields);
 
+    // Description:
+    // The float weights of a criterion, NULL when unweighted or empty
+    const float *GetCriterionWeights(int criterion) {
+      return (criterion<static_cast<int>(this->CriterionWeights.size())) ?
+        this->CriterionWeights[criterion] : NULL;
+    }
+
+    // Description:
+    // Single pass conversion of a weights array, a plain loop the compiler
+    // can vectorize. Only used when the array type is not the one needed.
+    template <typename TIn, typename TOut>
+    static void ConvertWeights(const TIn *in, vtkIdType n, TOut *out) {
+      for (vtkIdType i=0; i<n; ++i) {
+        out[i] = static_cast<TOut>(in[i]);
+      }
+    }
+
+    // Description:
+    // Fallback used when the partition method does not give us boxes : the
+    // bounds of the points assigned to each partition are gathered from all
+    // processes and set in the BoxList/ExtentTranslator
+    void ComputePartitionBoundingBoxes(vtkBoundingBox &globalBounds);
+
+    // Description:
+    // Sum the kept/exported counts of the last load balance over all processes
+    void ComputeMigrationStatistics(vtkIdType numObjects);
+
+    // Description:
+    // Raise PeakMigrationBufferBytes to the largest buffer over all processes,
+    // warns when an exchange named 'unbounded' exceeds MaxMigrationBufferBytes
+    void UpdatePeakMigrationBuffer(vtkIdType bytes, const char *unbounded=NULL);
+
+    // Description:
+    // Find the node of every rank and decide if the node hierarchy is used
+    void ComputeNodeTopology();
+
+    // Description:
+    // Number of the parts [part0,part1) put below a bisection. Ranges spread
+    // over several nodes (when the node hierarchy is used) are cut on the node
+    // boundary nearest the middle, ranges spread over several processes on the
+    // process boundary nearest the middle, so that the pieces of a process form
+    // a subtree and its box is the union of theirs.
+    int GetLowerPartCount(int part0, int part1);
+
+    // Description:
+    // Zoltan HIER is only used with one part per process of the same size
+    bool UseZoltanHierarchy() {
+      return this->UseNodeHierarchy && this->PartsPerProcess==1 && this->PartSizes.empty();
+    }
+
+    // Description:
+    // Set PointBytes, the size of one point (fields and coordinates) as migrated
+    void ComputePointBytes();
+
+    // Description:
+    // Set PartSizes from the process capacities (AutoCapacity is collective),
+    // left empty when all the parts have the same size
+    void ComputePartSizes();
+
+    // Description:
+    // Fraction of the total weight targeted at the parts [part0,part1)
+    double GetPartSizeFraction(int part0, int part1);
+
+    // Description:
+    // After the partition boxes (one per part) have been computed, keep them
+    // as the piece boxes and replace them by the bounds of each process' pieces
+    void GroupPieceBoundingBoxes();
+
+    // Description:
+    // Fill the pieces output with one block per local piece, cells go to the
+    // piece of their first point held by this process
+    void ExtractPieces(vtkPointSet *output, vtkMultiBlockDataSet *pieces);
+
+    // Description:
+    // Sum the weight of each criterion assigned to each part by the last
+    // load balance and set CriterionImbalance
+    void ComputeCriterionImbalance(vtkIdType numPoints);
+
+    // Description:
+    // Measure the imbalance of the current distribution (collective), true
+    // when it is within the threshold and the bounds of the processes (set in
+    // BoxList) are disjoint, the partition can then be skipped
+    bool IsAlreadyBalanced(vtkIdType numPoints, vtkBoundingBox &globalBounds);
+
+    // Description:
+    // Choose the sample points (one at random in each run of 1/fraction local
+    // Ids) when sampling is enabled, the Zoltan callbacks then only give the
+    // sample points. Returns false (on all processes) when every point is used.
+    bool SelectSamplePoints(vtkIdType numPoints);
+
+    // Description:
+    // Set SampleImbalance from the part of each sample point
+    void ComputeSampleImbalance(const std::vector<int> &sampleParts);
+
+    // Description:
+    // Called at the end of RequestData, destroys the Zoltan structure unless
+    // it must be retained for the next (incremental) partition
+    void ReleaseZoltanData();
+
     //
     vtkBoundingBox                             *LocalBox;
     std::vector<vtkBoundingBox>                 BoxList;
@@ -476,6 +898,43 @@ class VTK_EXPORT vtkZoltanBasePartitionFilter : public vtkDataSetAlgorithm
     double                                      MaxAspectRatio;
     int                                         KeepInversePointLists;
     int                                         InputDisposable;
+    int                                         IncrementalPartitioning;
+    int                                         PartitionMethod;
+    vtkIdType                                   NumberOfObjectsKept;
+    vtkIdType                                   NumberOfObjectsMigrated;
+    vtkIdType                                   NumberOfObjectsMigratedOffNode;
+    int                                         MigrationCostAware;
+    double                                      RepartitionMultiplier;
+    int                                         PointBytes;
+    vtkIdType                                   NumberOfBytesMigrated;
+    double                                      ImbalanceThreshold;
+    int                                         PartitionSkipped;
+    double                                      BalancedThreshold;
+    bool                                        SkippingPartition;   // last decision, for the hysteresis
+    int                                         MigrationTransport;
+    vtkIdType                                   MaxMigrationBufferBytes;
+    vtkIdType                                   PeakMigrationBufferBytes;
+    int                                         NumberOfMigrationRounds;
+    double                                      SparseMigrationFraction;
+    int                                         SparseMigrationUsed;
+    //
+    int                                         HierarchicalPartitioning;
+    int                                         VirtualRanksPerNode;
+    int                                         NumberOfNodes;
+    int                                         RanksPerNode;        // 0 if not the same on every node
+    bool                                        NodeRanksContiguous; // nodes hold consecutive ranks
+    bool                                        UseNodeHierarchy;
+    std::vector<int>                            NodeOfRank;
+    //
+    int                                         PiecesPerProcess;
+    int                                         PartsPerProcess;     // as used by the last partition
+    int                                         NumberOfParts;       // PartsPerProcess*UpdateNumPieces
+    std::vector<int>                            PointParts;          // part of each input point
+    std::vector<double>                         ProcessCapacities;
+    int                                         AutoCapacity;
+    std::vector<double>                         PartSizes;           // fraction of each part, empty if uniform
+    std::vector<vtkBoundingBox>                 PieceBoxList;
+    vtkSmartPointer<vtkBoundsExtentTranslator>  PieceExtentTranslator;
     vtkSmartPointer<vtkBoundsExtentTranslator>  ExtentTranslator;
     vtkSmartPointer<vtkBoundsExtentTranslator>  InputExtentTranslator;
     vtkSmartPointer<vtkPKdTree>                 KdTree;
@@ -483,11 +942,28 @@ class VTK_EXPORT vtkZoltanBasePartitionFilter : public vtkDataSetAlgorithm
     MigrationLists                              MigrateLists;
     //
     char                                       *PointWeightsArrayName;
-    void                                       *weights_data_ptr;
+    std::vector<std::string>                    PointWeightsArrayNames;
+    int                                         MultiCriteriaNorm;
+    int                                         NumberOfWeightCriteria;
+    // weights of each criterion as float, pointing into the weights array
+    // itself when it is float, otherwise into the converted copy
+    std::vector<vtkDataArray*>                  CriterionArrays;
+    std::vector<const float*>                   CriterionWeights;
+    std::vector<std::vector<float> >            ConvertedWeights;
+    std::vector<double>                         CriterionImbalance;
+    //
+    double                                      SampleFraction;
+    vtkIdType                                   SampleTargetCount;
+    vtkIdType                                   NumberOfSamplePoints;
+    double                                      SampleImbalance;
     //
     struct Zoltan_Struct       *ZoltanData;
     CallbackData                ZoltanCallbackData;
     ZoltanLoadBalanceData       LoadBalanceData;
+    // export lists owned by the filter (used when not computed by zoltan)
+    std::vector<ZOLTAN_ID_TYPE> ExportGlobalIds;
+    std::vector<int>            ExportProcs;
+    std::vector<int>            ExportParts;
     //
     float                       ImbalanceValue;
 
@@ -28,89 +28,143 @@ void vtkZoltanBasePartitionFilter::get_geometry_list(
   int num_dim, double *geom_vec, int *ierr)
 {
   CallbackData *callbackdata = static_cast<CallbackData*>(data);
-  for (int i=0;  i<num_obj; i++){
-    geom_vec[3*i]   = ((T*)(callbackdata->InputPointsData))[3*i+0];
-    geom_vec[3*i+1] = ((T*)(callbackdata->InputPointsData))[3*i+1];
-    geom_vec[3*i+2] = ((T*)(callbackdata->InputPointsData))[3*i+2];
+  const std::vector<vtkIdType> &samples = callbackdata->SampleIds;
+  for (int j=0;  j<num_obj; j++){
+    vtkIdType i = samples.empty() ? j : samples[j];
+    geom_vec[3*j]   = ((T*)(callbackdata->InputPointsData))[3*i+0];
+    geom_vec[3*j+1] = ((T*)(callbackdata->InputPointsData))[3*i+1];
+    geom_vec[3*j+2] = ((T*)(callbackdata->InputPointsData))[3*i+2];
   }
   *ierr = ZOLTAN_OK;
   return;
 }
 
 //----------------------------------------------------------------------------
-// A ZOLTAN_OBJ_SIZE_FN query function returns the size (in bytes) of the data buffer
-// that is needed to pack all of a single object's data.
-//
-// Here we add up the size of all the field arrays for points + the geometry itself
-//
-// Function Type:   ZOLTAN_OBJ_SIZE_FN_TYPE
-// Arguments:
-//  data             Pointer to user-defined data.
-//  num_gid_entries  The number of array entries used to describe a single global ID.
-//  num_lid_entries  The number of array entries used to describe a single local ID.
-//  global_id        Pointer to the global ID of the object.
-//  local_id         Pointer to the local ID of the object.
-//  ierr             Error code to be set by function.
-// Returned Value:
-//  int              The size (in bytes) of the required data buffer (per object).
+// A ZOLTAN_OBJ_SIZE_MULTI_FN query function returns the size (in bytes) of the
+// data buffer needed to pack each object, all points carry the same fields
+// so every size is the sum of the field tuples + the geometry itself
 //----------------------------------------------------------------------------
 template<typename T>
-int vtkZoltanBasePartitionFilter::zoltan_obj_size_function_pointdata(void *data,
-  int num_gid_entries, int num_lid_entries, ZOLTAN_ID_PTR global_id,
-  ZOLTAN_ID_PTR local_id, int *ierr)
+void vtkZoltanBasePartitionFilter::zoltan_obj_size_multi_function_pointdata(void *data,
+  int num_gid_entries, int num_lid_entries, int num_ids,
+  ZOLTAN_ID_PTR global_ids, ZOLTAN_ID_PTR local_ids, int *sizes, int *ierr)
 {
   INC_SIZE_COUNT
   CallbackData *callbackdata = static_cast<CallbackData*>(data);
+  std::fill(sizes, sizes+num_ids, static_cast<int>(callbackdata->TotalSizePerId + sizeof(T)*3));
   *ierr = ZOLTAN_OK;
-  return callbackdata->TotalSizePerId + sizeof(T)*3;
 }
 
 //----------------------------------------------------------------------------
-// Zoltan callback to pack all the data for one point into a buffer
+// Copy tuples of S bytes between a contiguous array and the per object
+// slots of a Zoltan buffer (object i at buf+idx[i]). The size is a compile
+// time constant so the copies are inlined instead of calling memcpy.
+//----------------------------------------------------------------------------
+template<int S>
+static inline void gather_tuples(const char *array, const ZOLTAN_ID_PTR ids, vtkIdType offset,
+  int n, char *buf, const int *idx)
+{
+  for (int i=0; i<n; ++i) {
+    memcpy(buf + idx[i], array + S*(static_cast<vtkIdType>(ids[i])-offset), S);
+  }
+}
+
+template<int S>
+static inline void scatter_tuples(char *array, int n, const char *buf, const int *idx)
+{
+  for (int i=0; i<n; ++i) {
+    memcpy(array + S*i, buf + idx[i], S);
+  }
+}
+
+//----------------------------------------------------------------------------
+// Choose the fixed size copy for the common tuple sizes (1 to 4 components
+// of 1, 2, 4 or 8 byte types, 9 doubles for tensors), others use memcpy
+//----------------------------------------------------------------------------
+#define PARTITION_TUPLE_SIZES(macro) \
+  macro(1) macro(2) macro(3) macro(4) macro(6) macro(8) macro(12) macro(16) \
+  macro(24) macro(32) macro(36) macro(72)
+
+static inline void gather_tuples(int size, const char *array, const ZOLTAN_ID_PTR ids,
+  vtkIdType offset, int n, char *buf, const int *idx)
+{
+  switch (size) {
+#define PARTITION_GATHER_CASE(S) case S: gather_tuples<S>(array, ids, offset, n, buf, idx); return;
+    PARTITION_TUPLE_SIZES(PARTITION_GATHER_CASE)
+#undef PARTITION_GATHER_CASE
+  }
+  for (int i=0; i<n; ++i) {
+    memcpy(buf + idx[i], array + size*(static_cast<vtkIdType>(ids[i])-offset), size);
+  }
+}
+
+static inline void scatter_tuples(int size, char *array, int n, const char *buf, const int *idx)
+{
+  switch (size) {
+#define PARTITION_SCATTER_CASE(S) case S: scatter_tuples<S>(array, n, buf, idx); return;
+    PARTITION_TUPLE_SIZES(PARTITION_SCATTER_CASE)
+#undef PARTITION_SCATTER_CASE
+  }
+  for (int i=0; i<n; ++i) {
+    memcpy(array + size*i, buf + idx[i], size);
+  }
+}
+#undef PARTITION_TUPLE_SIZES
+
+//----------------------------------------------------------------------------
+// Zoltan callback to pack all the points sent by this process in one call.
+// Each object keeps the layout of the single object version (fields in
+// order then the coordinates) but the arrays are gathered one at a time.
 //----------------------------------------------------------------------------
 template<typename T>
-void vtkZoltanBasePartitionFilter::zoltan_pack_obj_function_pointdata(void *data, int num_gid_entries, int num_lid_entries,
-  ZOLTAN_ID_PTR global_id, ZOLTAN_ID_PTR local_id, int dest, int size, char *buf, int *ierr)
+void vtkZoltanBasePartitionFilter::zoltan_pack_obj_multi_function_pointdata(void *data,
+  int num_gid_entries, int num_lid_entries, int num_ids,
+  ZOLTAN_ID_PTR global_ids, ZOLTAN_ID_PTR local_ids, int *dest, int *sizes, int *idx,
+  char *buf, int *ierr)
 {
   INC_PACK_COUNT
   CallbackData *callbackdata = static_cast<CallbackData*>(data);
-  vtkIdType GID = *global_id;
-  vtkIdType LID = GID - callbackdata->ProcessOffsetsPointId[callbackdata->ProcessRank];
+  vtkIdType offset = callbackdata->ProcessOffsetsPointId[callbackdata->ProcessRank];
   //
+  char *field = buf;
   for (int i=0; i<callbackdata->NumberOfFields; i++) {
     int asize = callbackdata->MemoryPerTuple[i];
-    char *dataptr = (char*)(callbackdata->InputArrayPointers[i]) + asize*LID;
-    memcpy(buf, dataptr, asize);
-    buf += asize;
+    gather_tuples(asize, static_cast<const char*>(callbackdata->InputArrayPointers[i]),
+      global_ids, offset, num_ids, field, idx);
+    field += asize;
   }
-  memcpy(buf, &((T*)(callbackdata->InputPointsData))[LID*3], sizeof(T)*3);
+  gather_tuples<sizeof(T)*3>(static_cast<const char*>(callbackdata->InputPointsData),
+    global_ids, offset, num_ids, field, idx);
   *ierr = ZOLTAN_OK;
-  return;
 }
 
 //----------------------------------------------------------------------------
-// Zoltan callback to unpack all the data for one point from a buffer
+// Zoltan callback to unpack all the points received by this process in one
+// call, they are appended in order after the OutPointCount points present
 //----------------------------------------------------------------------------
 template<typename T>
-void vtkZoltanBasePartitionFilter::zoltan_unpack_obj_function_pointdata(void *data, int num_gid_entries,
-  ZOLTAN_ID_PTR global_id, int size, char *buf, int *ierr)
+void vtkZoltanBasePartitionFilter::zoltan_unpack_obj_multi_function_pointdata(void *data,
+  int num_gid_entries, int num_ids, ZOLTAN_ID_PTR global_ids, int *sizes, int *idx,
+  char *buf, int *ierr)
 {
   INC_UNPACK_COUNT
   CallbackData *callbackdata = static_cast<CallbackData*>(data);
-  vtkIdType GID = *global_id;
+  vtkIdType first = callbackdata->OutPointCount;
   //
+  const char *field = buf;
   for (int i=0; i<callbackdata->NumberOfFields; i++) {
     int asize = callbackdata->MemoryPerTuple[i];
-    char *dataptr = (char*)(callbackdata->OutputArrayPointers[i]) + asize*(callbackdata->OutPointCount);
-    memcpy(dataptr, buf, asize);
-    buf += asize;
+    scatter_tuples(asize, static_cast<char*>(callbackdata->OutputArrayPointers[i]) + asize*first,
+      num_ids, field, idx);
+    field += asize;
+  }
+  scatter_tuples<sizeof(T)*3>(static_cast<char*>(callbackdata->OutputPointsData) + sizeof(T)*3*first,
+    num_ids, field, idx);
+  for (int i=0; i<num_ids; i++) {
+    add_Id_to_interval_map(callbackdata, global_ids[i], first+i);
   }
-//  if (callbackdata->self->UpdatePiece==2 && GID <100) { std::cout <<"Received " << GID << std::endl; }
-  add_Id_to_interval_map(callbackdata, GID, callbackdata->OutPointCount);
-  memcpy(&((T*)(callbackdata->OutputPointsData))[callbackdata->OutPointCount*3], buf, sizeof(T)*3);
-  callbackdata->OutPointCount++;
+  callbackdata->OutPointCount += num_ids;
   *ierr = ZOLTAN_OK;
-  return;
 }
 
 //----------------------------------------------------------------------------
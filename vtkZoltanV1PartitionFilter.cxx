@@ -91,6 +91,23 @@ void vtkZoltanV1PartitionFilter::ExecuteZoltanPartition(
     vtkPointSet *output,
     vtkPointSet *input)
 {
+  if (this->PartitionMethod==vtkZoltanBasePartitionFilter::MultiJagged) {
+    vtkWarningMacro(<<"MultiJagged requires Zoltan2, using RCB instead");
+  }
+
+  //
+  // Zoltan cannot locate points in a hierarchical partition, all points are used then
+  //
+  bool sampling = false;
+  if (this->UseZoltanHierarchy()) {
+    if (this->SampleFraction>0.0 || this->SampleTargetCount>0) {
+      vtkWarningMacro(<<"Sampling is not supported with hierarchical partitioning, using all points");
+    }
+  }
+  else {
+    sampling = this->SelectSamplePoints(input->GetNumberOfPoints());
+  }
+
   //
   // Zoltan can now partition our points.
   // After this returns, we have redistributed points and the Output holds
@@ -118,16 +135,84 @@ void vtkZoltanV1PartitionFilter::ExecuteZoltanPartition(
     Zoltan_Destroy(&this->ZoltanData);
     exit(0);
   }
+
+  //
+  // Only the sample points were partitioned, every point now goes to the part
+  // whose region contains it (using the cuts kept by Zoltan)
+  //
+  if (sampling) {
+    const std::vector<vtkIdType> &samples = this->ZoltanCallbackData.SampleIds;
+    vtkIdType offset = this->ZoltanCallbackData.ProcessOffsetsPointId[this->ZoltanCallbackData.ProcessRank];
+    std::vector<int> sampleParts(samples.size(), this->UpdatePiece*this->PartsPerProcess);
+    for (int i=0; i<this->LoadBalanceData.numExport; ++i) {
+      vtkIdType localId = this->LoadBalanceData.exportGlobalGids[i] - offset;
+      size_t j = std::lower_bound(samples.begin(), samples.end(), localId) - samples.begin();
+      sampleParts[j] = this->LoadBalanceData.exportToPart[i];
+    }
+    Zoltan_LB_Free_Part(&this->LoadBalanceData.importGlobalGids, &this->LoadBalanceData.importLocalGids,
+      &this->LoadBalanceData.importProcs, &this->LoadBalanceData.importToPart);
+    Zoltan_LB_Free_Part(&this->LoadBalanceData.exportGlobalGids, &this->LoadBalanceData.exportLocalGids,
+      &this->LoadBalanceData.exportProcs, &this->LoadBalanceData.exportToPart);
+    this->ComputeSampleImbalance(sampleParts);
+    this->ZoltanCallbackData.SampleIds.clear();
+    //
+    vtkIdType N = input->GetNumberOfPoints();
+    std::vector<int> parts(N);
+    for (vtkIdType i=0; i<N; ++i) {
+      double x[3];
+      int proc, part;
+      input->GetPoint(i, x);
+      if (Zoltan_LB_Point_PP_Assign(this->ZoltanData, x, &proc, &part) != ZOLTAN_OK) {
+        printf("Zoltan_LB_Point_PP_Assign NOT OK...\n");
+        MPI_Finalize();
+        Zoltan_Destroy(&this->ZoltanData);
+        exit(0);
+      }
+      parts[i] = part;
+    }
+    this->SetExportListsFromParts(parts);
+    return;
+  }
+
+  //
+  // With several parts per process the (PARTS) export list holds every object
+  // and its part, parts [p*K,(p+1)*K) are on process p (NUM_LOCAL_PARTS=K).
+  // Keep the parts and use our own lists of the objects leaving this process.
+  //
+  if (this->PartsPerProcess>1) {
+    vtkIdType N = input->GetNumberOfPoints();
+    vtkIdType offset = this->ZoltanCallbackData.ProcessOffsetsPointId[this->ZoltanCallbackData.ProcessRank];
+    std::vector<int> parts(N, this->UpdatePiece*this->PartsPerProcess);
+    for (int i=0; i<this->LoadBalanceData.numExport; ++i) {
+      parts[this->LoadBalanceData.exportGlobalGids[i] - offset] = this->LoadBalanceData.exportToPart[i];
+    }
+    Zoltan_LB_Free_Part(&this->LoadBalanceData.importGlobalGids, &this->LoadBalanceData.importLocalGids,
+      &this->LoadBalanceData.importProcs, &this->LoadBalanceData.importToPart);
+    Zoltan_LB_Free_Part(&this->LoadBalanceData.exportGlobalGids, &this->LoadBalanceData.exportLocalGids,
+      &this->LoadBalanceData.exportProcs, &this->LoadBalanceData.exportToPart);
+    this->SetExportListsFromParts(parts);
+  }
 }
 
 //----------------------------------------------------------------------------
 void vtkZoltanV1PartitionFilter::GetZoltanBoundingBoxes(vtkBoundingBox &globalBounds)
 {
+  //
+  // Only (flat) RCB keeps cuts which can be turned into boxes
+  //
+  if (this->PartitionMethod==vtkZoltanBasePartitionFilter::RIB ||
+      this->PartitionMethod==vtkZoltanBasePartitionFilter::HSFC ||
+      this->UseZoltanHierarchy())
+  {
+    this->ComputePartitionBoundingBoxes(globalBounds);
+    return;
+  }
+
   //
   // Get bounding boxes from zoltan and set them in the ExtentTranslator
   //
   this->BoxList.clear();
-  for (int p = 0; p<this->UpdateNumPieces; p++) {
+  for (int p = 0; p<this->NumberOfParts; p++) {
     double bounds[6];
     int ndim;
     if (ZOLTAN_OK == Zoltan_RCB_Box(this->ZoltanData, p, &ndim, &bounds[0], &bounds[2], &bounds[4], &bounds[1], &bounds[3], &bounds[5])) {
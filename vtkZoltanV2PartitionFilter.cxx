@@ -37,6 +37,7 @@
 #include "vtkInformationIntegerKey.h"
 #include "vtkFloatArray.h"
 #include "vtkDoubleArray.h"
+#include "vtkTypeTraits.h"
 //
 // For PARAVIEW_USE_MPI
 #include "vtkPVConfig.h"
@@ -59,6 +60,7 @@
 //
 #define _USE_MATH_DEFINES
 #include <cmath>
+#include <cstdlib>
 #include <numeric>
 #include <algorithm>
 #include <map>
@@ -91,6 +93,12 @@
 #endif
 //----------------------------------------------------------------------------
 
+//----------------------------------------------------------------------------
+struct vtkZoltan2ProblemBase
+{
+    virtual ~vtkZoltan2ProblemBase() {}
+};
+
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkZoltanV2PartitionFilter);
 //----------------------------------------------------------------------------
@@ -100,17 +108,28 @@ vtkStandardNewMacro(vtkZoltanV2PartitionFilter);
 //----------------------------------------------------------------------------
 vtkZoltanV2PartitionFilter::vtkZoltanV2PartitionFilter()
 {
-  this->ZoltanParams = new Teuchos::ParameterList;
+  this->PartitionMethod = vtkZoltanBasePartitionFilter::MultiJagged;
+  this->ZoltanParams    = new Teuchos::ParameterList;
+  this->Problem         = nullptr;
+  this->PartitionBackend = vtkZoltanV2PartitionFilter::Zoltan2;
+  this->Zoltan2Profile  = vtkZoltanV2PartitionFilter::Production;
+  this->ComputeMetrics  = 0;
 }
 //----------------------------------------------------------------------------
 vtkZoltanV2PartitionFilter::~vtkZoltanV2PartitionFilter()
 {
+  // the problem points to the parameter list
+  delete this->Problem;
   if (this->ZoltanParams) delete this->ZoltanParams;
 }
 
 //----------------------------------------------------------------------------
 void vtkZoltanV2PartitionFilter::InitializeZoltanLoadBalance()
 {
+    if (!this->UseZoltan2()) {
+        this->Superclass::InitializeZoltanLoadBalance();
+        return;
+    }
     // TODO : To be removed later
 #ifdef HAVE_ZOLTAN2_MPI
     int rank, nprocs;
@@ -122,15 +141,74 @@ void vtkZoltanV2PartitionFilter::InitializeZoltanLoadBalance()
 
     // Zoltan 2 parameters
     double tolerance = 1.1;
-    if (this->ZoltanParams) delete this->ZoltanParams;
-    this->ZoltanParams = new Teuchos::ParameterList("test params");
-    this->ZoltanParams->set("debug_level", "basic_status");
+    // refill the same list, a retained problem holds a pointer to it
+    bool debug = (this->Zoltan2Profile==vtkZoltanV2PartitionFilter::Debug);
+    *this->ZoltanParams = Teuchos::ParameterList("zoltan2 params");
+    this->ZoltanParams->set("debug_level", debug ? "basic_status" : "no_status");
     this->ZoltanParams->set("debug_procs", "0");
-    this->ZoltanParams->set("error_check_level", "debug_mode_assertions");
-    this->ZoltanParams->set("compute_metrics", "true");
-    this->ZoltanParams->set("algorithm", "multijagged");
+    this->ZoltanParams->set("error_check_level", debug ? "debug_mode_assertions" : "no_assertions");
+    this->ZoltanParams->set("compute_metrics", this->MetricsEnabled() ? "true" : "false");
+    // the multi-jagged cuts (also used for rcb) need parts of the same size,
+    // with process capacities the Zoltan RCB is used through Zoltan2
+    bool uniformParts = this->PartSizes.empty();
+    switch (this->PartitionMethod) {
+      case vtkZoltanBasePartitionFilter::RCB:
+        if (uniformParts) {
+          this->ZoltanParams->set("algorithm", "rcb");
+          break;
+        }
+        // fall through
+      case vtkZoltanBasePartitionFilter::RIB:
+      case vtkZoltanBasePartitionFilter::HSFC:
+        {
+          // no native implementation in Zoltan2, use the Zoltan one through Zoltan2
+          this->ZoltanParams->set("algorithm", "zoltan");
+          Teuchos::ParameterList &zparams = this->ZoltanParams->sublist("zoltan_parameters", false);
+          zparams.set("LB_METHOD",
+            this->PartitionMethod==vtkZoltanBasePartitionFilter::RIB ? "RIB" :
+            this->PartitionMethod==vtkZoltanBasePartitionFilter::HSFC ? "HSFC" : "RCB");
+        }
+        break;
+      default:
+        if (uniformParts) {
+          this->ZoltanParams->set("algorithm", "multijagged");
+        }
+        else {
+          vtkDebugMacro("Process capacities need Zoltan RCB, multi-jagged not used");
+          this->ZoltanParams->set("algorithm", "zoltan");
+          this->ZoltanParams->sublist("zoltan_parameters", false).set("LB_METHOD", "RCB");
+        }
+        break;
+    }
     this->ZoltanParams->set("imbalance_tolerance", tolerance);
-    this->ZoltanParams->set("num_global_parts", nprocs);
+    if (this->NumberOfWeightCriteria>1) {
+      // balance all weights together, the norms match Zoltan RCB_MULTICRITERIA_NORM
+      const char *objective[3] = {
+        "multicriteria_minimize_total_weight",
+        "multicriteria_balance_total_maximum",
+        "multicriteria_minimize_maximum_weight" };
+      this->ZoltanParams->set("partitioning_objective", objective[this->MultiCriteriaNorm-1]);
+    }
+    this->ZoltanParams->set("num_global_parts", this->NumberOfParts);
+    if (this->UseNodeHierarchy) {
+      // multi-jagged cuts into nodes first, then into the ranks of each node,
+      // parts of a node are numbered consecutively so this needs uniform nodes
+      // holding consecutive ranks
+      if (this->PartitionMethod==vtkZoltanBasePartitionFilter::MultiJagged && uniformParts &&
+          this->RanksPerNode>0 && this->NodeRanksContiguous)
+      {
+        std::stringstream parts;
+        parts << this->NumberOfNodes << "," << this->RanksPerNode;
+        if (this->PartsPerProcess>1) {
+          parts << "," << this->PartsPerProcess;
+        }
+        this->ZoltanParams->set("mj_parts", parts.str());
+      }
+      else {
+        vtkWarningMacro("Hierarchical partitioning needs the MultiJagged method, equal process "
+          "capacities and the same number of consecutive ranks on each node, using a flat partition");
+      }
+    }
     this->ZoltanParams->set("bisection_num_test_cuts", 1);
     this->ZoltanParams->set("mj_keep_part_boxes", 1);
 
@@ -186,6 +264,30 @@ void vtkZoltanV2PartitionFilter::InitializeZoltanLoadBalance()
     vtkZoltanBasePartitionFilter::InitializeZoltanLoadBalance();
 }
 
+//----------------------------------------------------------------------------
+// The adapter and problem of the last execution, the problem holds pointers
+// to the adapter (and the parameter list) so they are deleted together
+//----------------------------------------------------------------------------
+template <typename scalar_t>
+struct vtkZoltan2Problem : public vtkZoltan2ProblemBase
+{
+    typedef Zoltan2::BasicUserTypes<scalar_t, globalId_t, localId_t> myTypes;
+    typedef Zoltan2::BasicVectorAdapter<myTypes> inputAdapter_t;
+    typedef Zoltan2::PartitioningProblem<inputAdapter_t> result_type;
+
+    vtkZoltan2Problem() : Count(0), Adapter(nullptr), Problem(nullptr) {}
+    virtual ~vtkZoltan2Problem() {
+        delete this->Problem;
+        delete this->Adapter;
+    }
+
+    std::vector<const void*>             Arrays;    // points, ids and weights the adapter uses
+    vtkIdType                            Count;
+    std::vector< std::vector<scalar_t> > Converted; // weights not already of type scalar_t
+    inputAdapter_t                      *Adapter;
+    result_type                         *Problem;
+};
+
 //----------------------------------------------------------------------------
 template <typename scalar_t>
 struct vtkZoltan2Helper
@@ -194,116 +296,155 @@ struct vtkZoltan2Helper
     typedef Zoltan2::BasicVectorAdapter<myTypes> inputAdapter_t;
     typedef typename inputAdapter_t::part_t part_t;
     typedef Zoltan2::PartitioningProblem<inputAdapter_t> result_type;
+    typedef vtkZoltan2Problem<scalar_t> holder_t;
+
+    // weights of one criterion as scalar_t, zero-copy when the types match
+    static const scalar_t *GetWeights(
+        vtkDataArray *weightsArray, vtkIdType localCount, std::vector<scalar_t> &buffer)
+    {
+        if (localCount==0) {
+            return NULL;
+        }
+        if (weightsArray->GetDataType()==vtkTypeTraits<scalar_t>::VTK_TYPE_ID) {
+            return static_cast<const scalar_t*>(weightsArray->GetVoidPointer(0));
+        }
+        buffer.resize(localCount);
+        switch (weightsArray->GetDataType()) {
+            vtkTemplateMacro(
+                vtkZoltanBasePartitionFilter::ConvertWeights(
+                    static_cast<const VTK_TT*>(weightsArray->GetVoidPointer(0)), localCount, &buffer[0]));
+            default:
+                buffer.assign(localCount, scalar_t(1));
+        }
+        return &buffer[0];
+    }
 
-    static result_type *SolveZoltan2Partition(
-        vtkDataArray *datarray, vtkIdType localCount,
-        globalId_t *globalIds, const scalar_t *weightarray,
+    static void SolveZoltan2Partition(
+        const scalar_t *points, vtkIdType localCount,
+        const globalId_t *globalIds, int numWeights,
         vtkZoltanV2PartitionFilter *self, vtkPointSet *input)
     {
-//#define ZERO_COPY_DATA
-#ifdef ZERO_COPY_DATA
-        // points are {x,y,z} in a single array
-        const scalar_t *x = static_cast<const scalar_t *>(datarray->GetVoidPointer(0));
-        const scalar_t *y = static_cast<const scalar_t *>(datarray->GetVoidPointer(1));
-        const scalar_t *z = static_cast<const scalar_t *>(datarray->GetVoidPointer(2));
+        // points are {x,y,z} in a single array, zoltan2 reads them in place
+        const scalar_t *x = (localCount>0) ? points     : nullptr;
+        const scalar_t *y = (localCount>0) ? points + 1 : nullptr;
+        const scalar_t *z = (localCount>0) ? points + 2 : nullptr;
         const int stride = 3;
-        debug_2("USING ZERO COPY ");
-#else
-        scalar_t *coords = new scalar_t[3*localCount];
-        scalar_t *x = coords;
-        scalar_t *y = x + localCount;
-        scalar_t *z = y + localCount;
-        const int stride = 1;
-        const scalar_t *p = static_cast<const scalar_t *>(datarray->GetVoidPointer(0));
-        for (int i = 0; i < localCount; ++i)
-        {
-            x[i] = p[i*3 + 0];
-            y[i] = p[i*3 + 1];
-            z[i] = p[i*3 + 2];
+
+        // the adapter/problem of the last execution, replaced if the point type changed
+        holder_t *holder = dynamic_cast<holder_t*>(self->Problem);
+        if (!holder) {
+            delete self->Problem;
+            self->Problem = holder = new holder_t;
         }
-#endif
-        // create an adapter that will point to the correct coordinates
-        inputAdapter_t *InputAdapter = nullptr;
-        result_type *problem1 = nullptr;
 
-        if (weightarray==NULL) {
-            InputAdapter = new inputAdapter_t(localCount, globalIds, x, y, z, stride, stride, stride);
-            problem1     = new result_type(InputAdapter, self->ZoltanParams);
+        // weights, the arrays themselves when their type matches scalar_t,
+        // otherwise converted into buffers which live as long as the adapter
+        holder->Converted.resize(numWeights);
+        std::vector<const scalar_t*> weightVec;
+        std::vector<int> weightStrides;
+        std::vector<const void*> arrays = {points, globalIds};
+        for (int c=0; c<numWeights; ++c) {
+            weightVec.push_back(GetWeights(self->CriterionArrays[c], localCount, holder->Converted[c]));
+            weightStrides.push_back(1);
+            arrays.push_back(localCount>0 ? self->CriterionArrays[c]->GetVoidPointer(0) : nullptr);
+        }
+
+        //
+        // the problem is kept while the adapter still points to the input
+        // arrays, only the parameters are reset, all processes must agree
+        //
+        int reuse = (holder->Problem && holder->Count==localCount && holder->Arrays==arrays) ? 1 : 0;
+        int allReuse = 0;
+        self->Controller->AllReduce(&reuse, &allReuse, 1, vtkCommunicator::MIN_OP);
+        if (allReuse) {
+            holder->Problem->resetParameters(self->ZoltanParams);
         }
         else {
-            // coordinates
-            std::vector<const scalar_t *> coordVec = {x, y, z};
-            std::vector<int> coordStrides = {stride, stride, stride};
-            // weights
-            std::vector<const scalar_t*> weightVec = {weightarray};
-            std::vector<int> weightStrides = {1};
-
-            InputAdapter = new inputAdapter_t(
-                localCount, globalIds,
-                coordVec, coordStrides,
-                weightVec, weightStrides);
-            problem1    = new Zoltan2::PartitioningProblem<inputAdapter_t>(InputAdapter, self->ZoltanParams);
+            delete holder->Problem;
+            delete holder->Adapter;
+            if (numWeights==0) {
+                holder->Adapter = new inputAdapter_t(localCount, globalIds, x, y, z, stride, stride, stride);
+            }
+            else {
+                std::vector<const scalar_t *> coordVec = {x, y, z};
+                std::vector<int> coordStrides = {stride, stride, stride};
+                holder->Adapter = new inputAdapter_t(
+                    localCount, globalIds,
+                    coordVec, coordStrides,
+                    weightVec, weightStrides);
+            }
+            holder->Problem = new result_type(holder->Adapter, self->ZoltanParams);
+            holder->Count   = localCount;
+            holder->Arrays  = arrays;
         }
+        result_type *problem1 = holder->Problem;
+
+        // part sizes from the process capacities, every process gives all of
+        // them, none (equal sizes) replaces the sizes of a reused problem
+        std::vector<part_t>   partIds;
+        std::vector<scalar_t> partSizes;
+        for (size_t part=0; part<self->PartSizes.size(); ++part) {
+            partIds.push_back(static_cast<part_t>(part));
+            partSizes.push_back(static_cast<scalar_t>(self->PartSizes[part]));
+        }
+        for (int c=0; c<std::max(numWeights, 1); ++c) {
+            problem1->setPartSizesForCriteria(c, static_cast<int>(partIds.size()),
+                partIds.empty() ? nullptr : &partIds[0],
+                partSizes.empty() ? nullptr : &partSizes[0], true);
+        }
+
         // Solve the problem
         problem1->solve();
 
-        // we may query this from outside the filter
-        self->ImbalanceValue = problem1->getWeightImbalance();
-
         // get the solution object
         const Zoltan2::PartitioningSolution<inputAdapter_t> &solution1 = problem1->getSolution();
 
-        int numExport = 0;
+        // parts [p*K,(p+1)*K) are on process p, the export lists
+        // hold the points leaving this process
         const part_t *partd = solution1.getPartListView();
-        for (int i = 0; i < localCount; ++i)
-        {
-            if (partd[i]!=self->UpdatePiece)
-            {
-                numExport++;
+        std::vector<int> parts(partd, partd + localCount);
+        self->SetExportListsFromParts(parts);
+
+        // we may query this from outside the filter
+        if (self->MetricsEnabled()) {
+            self->ImbalanceValue = problem1->getWeightImbalance();
+        }
+        else {
+            int P = self->NumberOfParts;
+            std::vector<double> local(P, 0.0), global(P, 0.0);
+            for (vtkIdType i=0; i<localCount; ++i) {
+                local[parts[i]] += (numWeights>0) ? weightVec[0][i] : 1.0;
+            }
+            self->Controller->AllReduce(&local[0], &global[0], P, vtkCommunicator::SUM_OP);
+            double total = std::accumulate(global.begin(), global.end(), 0.0), most = 0.0;
+            for (int p=0; p<P && total>0.0; ++p) {
+                double share = self->GetPartSizeFraction(p, p+1);
+                most = std::max(most, global[p]/(total*(share>0.0 ? share : 1.0/P)));
             }
+            self->ImbalanceValue = total>0.0 ? static_cast<float>(most) : 1.0f;
         }
 
-        unsigned int *exportLocalGids = new unsigned int[numExport];
-        unsigned int *exportGlobalGids = new unsigned int[numExport];
-        int *exportProcs = new int[numExport];
-        int k = 0;
-        int offset = self->ZoltanCallbackData.ProcessOffsetsPointId[self->ZoltanCallbackData.ProcessRank];
-        for (int i = 0; i < localCount; ++i)
-        {
-            if (partd[i]!=self->UpdatePiece){
-                exportLocalGids[k] = i;
-                exportGlobalGids[k] = i + offset;
-                exportProcs[k] = partd[i];
-                k++;
-            }
+        // Zoltan 2 bounding box code, only multijagged keeps the part boxes,
+        // they are clipped to the data in GetZoltanBoundingBoxes
+        self->PartBounds.clear();
+        if (self->PartitionMethod!=vtkZoltanBasePartitionFilter::MultiJagged ||
+            !self->PartSizes.empty()) {
+            return;
         }
-        self->LoadBalanceData.numExport = numExport;
-        self->LoadBalanceData.exportGlobalGids = exportGlobalGids;
-        self->LoadBalanceData.exportLocalGids  = exportLocalGids;
-        self->LoadBalanceData.exportProcs = exportProcs;
-        self->LoadBalanceData.exportToPart = exportProcs;
-
-        // Zoltan 2 bounding box code
-        self->BoxList.clear();
         std::vector<Zoltan2::coordinateModelPartBox<scalar_t, part_t> > &boxView = solution1.getPartBoxesView();
-        for (int i=0; i<boxView.size(); i++) {
-            double bounds[6];
+        if (static_cast<int>(boxView.size())!=self->NumberOfParts) {
+            return;
+        }
+        self->PartBounds.resize(6*self->NumberOfParts);
+        for (size_t i=0; i<boxView.size(); i++) {
             scalar_t *minss = boxView[i].getlmins();
             scalar_t *maxss = boxView[i].getlmaxs();
-            bounds[0] = minss[0];
-            bounds[1] = maxss[0];
-            bounds[2] = minss[1];
-            bounds[3] = maxss[1];
-            bounds[4] = minss[2];
-            bounds[5] = maxss[2];
-            vtkBoundingBox box(bounds);
-            self->BoxList.push_back(box);
-            self->ExtentTranslator->SetBoundsForPiece(i, bounds);
+            double *bounds = &self->PartBounds[6*boxView[i].getpId()];
+            for (int j=0; j<3; j++) {
+                bounds[2*j]   = minss[j];
+                bounds[2*j+1] = maxss[j];
+            }
         }
-#ifndef ZERO_COPY_DATA
-        delete []coords;
-#endif
-        return problem1;
     }
 };
 
@@ -320,32 +461,34 @@ void vtkZoltanV2PartitionFilter::ExecuteZoltanPartition(
     vtkPointSet *output,
     vtkPointSet *input)
 {
+    if (!this->UseZoltan2()) {
+        this->PartBounds.clear();
+        this->Superclass::ExecuteZoltanPartition(output, input);
+        return;
+    }
     //
-    // Get the input arrays, points coordinates and weights
+    // The input points (float or double, the same type on every process)
+    // are given to zoltan2 as they are, weights are set up in the helper
     //
 
-    // get the array that is used for coordinates, it might be float or double
-    vtkPoints    *myInPoints = input->GetPoints();
-    vtkDataArray *coordArray = (myInPoints!=nullptr)?myInPoints->GetData():nullptr;
-
     //////////////////////////////////////////////////////////////////////
     // Zoltan 2 partitioning
     //////////////////////////////////////////////////////////////////////
-    int rank = this->UpdatePiece;
-    int nprocs = this->UpdateNumPieces;
-
-    int localCount = (coordArray)?coordArray->GetNumberOfTuples():0;
-    // global Ids should be optional, fix this when they are
-    globalId_t *globalIds = new globalId_t [localCount];
+    vtkIdType localCount = input->GetNumberOfPoints();
+    // global Ids should be optional, fix this when they are, until then the
+    // buffer is kept and only grows between executions
     globalId_t offset = this->ZoltanCallbackData.ProcessOffsetsPointId[this->ZoltanCallbackData.ProcessRank];
-    for (size_t i=0; i < localCount; i++)
-        globalIds[i] = offset++;
+    this->GlobalIds.resize(localCount);
+    std::iota(this->GlobalIds.begin(), this->GlobalIds.end(), offset);
+    const globalId_t *globalIds = localCount>0 ? &this->GlobalIds[0] : nullptr;
 
-    switch(/*coordArray->GetDataType()*/ VTK_FLOAT)
+    switch(this->ZoltanCallbackData.PointType)
     {
         vtkZoltanTemplateMacro(
             vtkZoltan2Helper<VTK_TT>::SolveZoltan2Partition(
-                coordArray, localCount, globalIds, static_cast<VTK_TT*>(this->weights_data_ptr), this, input));
+                static_cast<const VTK_TT*>(this->ZoltanCallbackData.InputPointsData),
+                localCount, globalIds,
+                this->NumberOfWeightCriteria, this, input));
     }
 
 
@@ -358,28 +501,121 @@ void vtkZoltanV2PartitionFilter::ExecuteZoltanPartition(
 //----------------------------------------------------------------------------
 void vtkZoltanV2PartitionFilter::GetZoltanBoundingBoxes(vtkBoundingBox &globalBounds)
 {
-/*
+    if (!this->UseZoltan2()) {
+        this->Superclass::GetZoltanBoundingBoxes(globalBounds);
+        return;
+    }
+    if (this->PartBounds.empty()) {
+        this->ComputePartitionBoundingBoxes(globalBounds);
+        return;
+    }
     //
-    // Get bounding boxes from zoltan and set them in the ExtentTranslator
+    // the multi-jagged boxes on the outside of the domain extend to the
+    // limits of the coordinate type, clip them to the data
     //
     this->BoxList.clear();
-    for (int p=0; p<this->UpdateNumPieces; p++) {
+    for (int p=0; p<this->NumberOfParts; p++) {
       double bounds[6];
-      int ndim;
-      if (ZOLTAN_OK==Zoltan_RCB_Box(this->ZoltanData, p, &ndim, &bounds[0], &bounds[2], &bounds[4], &bounds[1], &bounds[3], &bounds[5])) {
-        if (bounds[0]==-DBL_MAX) { bounds[0] = globalBounds.GetMinPoint()[0]; }
-        if (bounds[1]== DBL_MAX) { bounds[1] = globalBounds.GetMaxPoint()[0]; }
-        if (bounds[2]==-DBL_MAX) { bounds[2] = globalBounds.GetMinPoint()[1]; }
-        if (bounds[3]== DBL_MAX) { bounds[3] = globalBounds.GetMaxPoint()[1]; }
-        if (bounds[4]==-DBL_MAX) { bounds[4] = globalBounds.GetMinPoint()[2]; }
-        if (bounds[5]== DBL_MAX) { bounds[5] = globalBounds.GetMaxPoint()[2]; }
-        vtkBoundingBox box(bounds);
-        this->BoxList.push_back(box);
-        this->ExtentTranslator->SetBoundsForPiece(p, bounds);
-        // cout<<"###"<<" ("<<bounds[0]<<", "<<bounds[1]<<")\t"<<" ("<<bounds[2]<<", "<<bounds[3]<<")\t"<<" ("<<bounds[4]<<", "<<bounds[5]<<")\t";
+      for (int j=0; j<3; j++) {
+        bounds[2*j]   = std::max(this->PartBounds[6*p+2*j],   globalBounds.GetMinPoint()[j]);
+        bounds[2*j+1] = std::min(this->PartBounds[6*p+2*j+1], globalBounds.GetMaxPoint()[j]);
       }
-      // cout<<endl;
+      vtkBoundingBox box(bounds);
+      this->BoxList.push_back(box);
+      this->ExtentTranslator->SetBoundsForPiece(p, bounds);
     }
-*/
     this->ExtentTranslator->InitWholeBounds();
 }
+
+//----------------------------------------------------------------------------
+// Multi-jagged cuts are guillotine cuts : any set of boxes of the partition
+// can be split by a plane which no box crosses. Rebuild a binary tree of
+// cuts from the boxes, choosing the split nearest the middle of the set.
+// Returns the index of the node, or -1 if the boxes cannot be split.
+//----------------------------------------------------------------------------
+static int AddGuillotineCuts(
+    const std::vector<vtkBoundingBox> &boxes, std::vector<int> &parts,
+    std::vector<int> &cut_axis, std::vector<double> &cut_position,
+    std::vector<int> &cut_lower, std::vector<int> &cut_upper)
+{
+    int node = static_cast<int>(cut_position.size());
+    cut_position.push_back(0.0);
+    cut_axis.push_back(0);
+    cut_lower.push_back(-1);
+    cut_upper.push_back(-1);
+    if (parts.size()==1) {
+        // leaf, set the (region) Id for BSPCuts to use
+        cut_lower[node] = -parts[0];
+        return node;
+    }
+    //
+    int best = -1, bestAxis = -1;
+    std::vector<int> bestOrder;
+    size_t n = parts.size();
+    for (int axis=0; axis<3; ++axis) {
+        std::vector<int> order(parts);
+        std::sort(order.begin(), order.end(), [&boxes, axis](int a, int b) {
+            return boxes[a].GetMinPoint()[axis] < boxes[b].GetMinPoint()[axis];
+        });
+        double lowerMax = boxes[order[0]].GetMaxPoint()[axis];
+        for (size_t k=1; k<n; ++k) {
+            if (lowerMax<=boxes[order[k]].GetMinPoint()[axis]) {
+                int distance = std::abs(static_cast<int>(2*k) - static_cast<int>(n));
+                if (best<0 || distance<std::abs(2*best - static_cast<int>(n))) {
+                    best      = static_cast<int>(k);
+                    bestAxis  = axis;
+                    bestOrder = order;
+                }
+            }
+            lowerMax = std::max(lowerMax, boxes[order[k]].GetMaxPoint()[axis]);
+        }
+    }
+    if (best<0) {
+        return -1;
+    }
+    std::vector<int> lowerParts(bestOrder.begin(), bestOrder.begin()+best);
+    std::vector<int> upperParts(bestOrder.begin()+best, bestOrder.end());
+    cut_axis[node]     = bestAxis;
+    cut_position[node] = boxes[bestOrder[best]].GetMinPoint()[bestAxis];
+    int lower = AddGuillotineCuts(boxes, lowerParts, cut_axis, cut_position, cut_lower, cut_upper);
+    int upper = lower<0 ? -1 : AddGuillotineCuts(boxes, upperParts, cut_axis, cut_position, cut_lower, cut_upper);
+    if (upper<0) {
+        return -1;
+    }
+    cut_lower[node] = lower;
+    cut_upper[node] = upper;
+    return node;
+}
+
+//----------------------------------------------------------------------------
+vtkSmartPointer<vtkPKdTree> vtkZoltanV2PartitionFilter::CreatePkdTree()
+{
+    if (!this->UseZoltan2()) {
+        return this->Superclass::CreatePkdTree();
+    }
+    // only the multi-jagged part boxes give us a tree of cuts
+    if (this->PartBounds.empty() || static_cast<int>(this->PieceBoxList.size())!=this->NumberOfParts ||
+        this->PartitionSkipped) {
+        this->KdTree = NULL;
+        return NULL;
+    }
+
+    // list we will pass to CreateCuts
+    std::vector<int>    cut_axis;
+    std::vector<double> cut_position;
+    std::vector<int>    cut_lower;
+    std::vector<int>    cut_upper;
+
+    std::vector<int> parts(this->NumberOfParts);
+    std::iota(parts.begin(), parts.end(), 0);
+    if (AddGuillotineCuts(this->PieceBoxList, parts, cut_axis, cut_position, cut_lower, cut_upper)<0) {
+        vtkWarningMacro("Multi-jagged boxes do not form a tree of cuts, no KdTree created");
+        this->KdTree = NULL;
+        return NULL;
+    }
+
+    // parts are not renumbered, region i is part i
+    std::vector<int> remapping(this->NumberOfParts);
+    std::iota(remapping.begin(), remapping.end(), 0);
+    return this->CreatePkdTreeFromCuts(cut_axis, cut_position, cut_lower, cut_upper, &remapping[0]);
+}
@@ -34,7 +34,7 @@
 #include "vtkBoundingBox.h"      // used as parameter
 #include "vtkSmartPointer.h"     // for memory safety
 //
-#include "vtkZoltanBasePartitionFilter.h"
+#include "vtkZoltanV1PartitionFilter.h" // superclass
 #include "zoltan.h"
 
 // standard vtk classes
@@ -56,6 +56,8 @@ class vtkInformationIntegerKey;
 namespace Teuchos {
   class ParameterList;
 }
+// the zoltan2 adapter/problem kept between executions
+struct vtkZoltan2ProblemBase;
 //----------------------------------------------------------------------------
 //
 // GCC has trouble resolving some templated function pointers, 
@@ -78,25 +80,73 @@ class vtkInformationDoubleKey;
 class vtkInformationDoubleVectorKey;
 class vtkInformationIntegerKey;
 //----------------------------------------------------------------------------
-class VTK_EXPORT vtkZoltanV2PartitionFilter : public vtkZoltanBasePartitionFilter
+class VTK_EXPORT vtkZoltanV2PartitionFilter : public vtkZoltanV1PartitionFilter
 {
   public:
     static vtkZoltanV2PartitionFilter *New();
-    vtkTypeMacro(vtkZoltanV2PartitionFilter,vtkZoltanBasePartitionFilter);
+    vtkTypeMacro(vtkZoltanV2PartitionFilter,vtkZoltanV1PartitionFilter);
+
+    // Description:
+    // Library used to compute the partition. Zoltan (v1) is always built
+    // with Zoltan2, so the backend can be chosen per filter instance and both
+    // compared on the same data. Zoltan1 uses the vtkZoltanV1PartitionFilter
+    // implementation and ignores the Zoltan2 specific settings.
+    enum PartitionBackends {
+      Zoltan1 = 1,
+      Zoltan2 = 2
+    };
+    vtkSetClampMacro(PartitionBackend, int, Zoltan1, Zoltan2);
+    vtkGetMacro(PartitionBackend, int);
+
+    // Description:
+    // Zoltan2 parameter profile, Production turns off status output and
+    // assertions, Debug enables them (debug_mode_assertions) and the metrics
+    enum Zoltan2Profiles {
+      Production = 0,
+      Debug      = 1
+    };
+    vtkSetClampMacro(Zoltan2Profile, int, Production, Debug);
+    vtkGetMacro(Zoltan2Profile, int);
+
+    // Description:
+    // Ask zoltan2 to compute the partition metrics (always done in the Debug
+    // profile), otherwise the imbalance is computed from the part weights
+    vtkSetMacro(ComputeMetrics, int);
+    vtkGetMacro(ComputeMetrics, int);
+    vtkBooleanMacro(ComputeMetrics, int);
 
   protected:
      vtkZoltanV2PartitionFilter();
     ~vtkZoltanV2PartitionFilter();
 
+    bool UseZoltan2() { return this->PartitionBackend==vtkZoltanV2PartitionFilter::Zoltan2; }
+
     virtual void InitializeZoltanLoadBalance();
     virtual void ExecuteZoltanPartition(vtkPointSet *output, vtkPointSet *input);
     virtual void GetZoltanBoundingBoxes(vtkBoundingBox &globalBounds);
+    virtual vtkSmartPointer<vtkPKdTree> CreatePkdTree();
+
+    bool MetricsEnabled() {
+      return this->Zoltan2Profile==vtkZoltanV2PartitionFilter::Debug || this->ComputeMetrics!=0;
+    }
 
 //BTX
     template<typename U>
     friend struct vtkZoltan2Helper;
 //ETX
+    // the same list is kept for the lifetime of the filter, the problem
+    // holds a pointer to it
     Teuchos::ParameterList *ZoltanParams;
+    // global Ids passed to zoltan2, reused between executions
+    std::vector<globalId_t> GlobalIds;
+    // multi-jagged part boxes {xmin,xmax,ymin,ymax,zmin,zmax} per part,
+    // empty for other methods
+    std::vector<double>     PartBounds;
+    // adapter and problem, reused while the input arrays are unchanged
+    vtkZoltan2ProblemBase  *Problem;
+    int                     PartitionBackend;
+    int                     Zoltan2Profile;
+    int                     ComputeMetrics;
 
   private:
     vtkZoltanV2PartitionFilter(const vtkZoltanV2PartitionFilter&);  // Not implemented.
@@ -1,5 +1,10 @@
-
-#ifdef VTK_ZOLTAN2_PARTITION_FILTER
+#if defined(VTK_SFC_PARTITION_FILTER)
+  #include "vtkSFCPartitionFilter.h" // superclass
+  #define VTK_ZOLTAN_PARTITION_FILTER vtkSFCPartitionFilter
+#elif defined(VTK_RCB_PARTITION_FILTER)
+  #include "vtkRCBPartitionFilter.h" // superclass
+  #define VTK_ZOLTAN_PARTITION_FILTER vtkRCBPartitionFilter
+#elif defined(VTK_ZOLTAN2_PARTITION_FILTER)
   #include "vtkZoltanV2PartitionFilter.h" // superclass
   #define VTK_ZOLTAN_PARTITION_FILTER vtkZoltanV2PartitionFilter
 #else